@@ -0,0 +1,74 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+// Compares the scalar and batch forward coordinate transformation of projHelper
+// usage: gf-bench-coord-transform [n_points] [source_crs] [process_crs]
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+#include <geoflow/geoflow.hpp>
+
+using namespace geoflow;
+
+int main(int argc, const char * argv[]) {
+  size_t n = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+  std::string source_crs = argc > 2 ? argv[2] : "EPSG:4326";
+  std::string process_crs = argc > 3 ? argv[3] : "EPSG:7415";
+
+  NodeRegisterMap node_registers;
+  NodeManager manager(node_registers);
+  manager.set_process_crs(process_crs.c_str());
+  manager.set_fwd_crs_transform(source_crs.c_str(), true);
+
+  // random points in a 0.1 degree square around Delft, for other source CRSs pass points in the same range
+  std::mt19937 gen(42);
+  std::uniform_real_distribution<double> dx(4.3, 4.4), dy(51.95, 52.05), dz(-5, 50);
+  std::vector<arr3d> points(n);
+  for (auto& p : points) p = {dx(gen), dy(gen), dz(gen)};
+
+  // set the data offset so that both runs use the same one
+  manager.coord_transform_fwd(points[0][0], points[0][1], points[0][2]);
+
+  vec3f scalar_result(n);
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i=0; i<n; ++i) {
+    scalar_result[i] = manager.coord_transform_fwd(points[i][0], points[i][1], points[i][2]);
+  }
+  std::chrono::duration<double> t_scalar = std::chrono::steady_clock::now() - t0;
+
+  vec3f batch_result(n);
+  // the batch transform overwrites its input
+  auto coords = points;
+  t0 = std::chrono::steady_clock::now();
+  manager.coord_transform_fwd(coords.data()->data(), n, 3, batch_result.data());
+  std::chrono::duration<double> t_batch = std::chrono::steady_clock::now() - t0;
+
+  float max_diff = 0;
+  for (size_t i=0; i<n; ++i) {
+    for (size_t j=0; j<3; ++j) max_diff = std::max(max_diff, std::abs(scalar_result[i][j] - batch_result[i][j]));
+  }
+
+  std::cout << n << " points from " << source_crs << " to " << process_crs << "\n";
+  std::cout << "scalar: " << t_scalar.count() << " s, " << n / t_scalar.count() << " points/s\n";
+  std::cout << "batch:  " << t_batch.count() << " s, " << n / t_batch.count() << " points/s\n";
+  std::cout << "speedup " << t_scalar.count() / t_batch.count() << "x, max difference " << max_diff << "\n";
+  return EXIT_SUCCESS;
+}
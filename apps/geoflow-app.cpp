@@ -18,8 +18,13 @@
 #include <fstream>
 #include <cstdlib>
 #include <utility>
+#include <algorithm>
+#include <sstream>
+#include <thread>
 
 #include <geoflow/geoflow.hpp>
+#include <geoflow/execution_plan.hpp>
+#include <geoflow/ExpressionComputer.hpp>
 #include <geoflow/plugin_manager.hpp>
 #include "version.h"
 
@@ -49,6 +54,14 @@ void load_plugins(PluginManager& plugin_manager, NodeRegisterMap& node_registers
   R_core->register_node<nodes::core::ProjTesterNode>("ProjTester");
   R_core->register_node<nodes::core::AttributeCalcNode>("AttributeCalc");
   R_core->register_node<nodes::core::AttributeRenamerNode>("AttributeRenamer");
+  R_core->register_node<nodes::core::FilterNode>("Filter");
+  R_core->register_node<nodes::core::ApplySelectionNode>("ApplySelection");
+  R_core->register_node<nodes::core::GeometryMeasuresNode>("GeometryMeasures");
+  R_core->register_node<nodes::core::WeldTrianglesNode>("WeldTriangles");
+  R_core->register_node<nodes::core::SpatialIndexNode>("SpatialIndex");
+  R_core->register_node<nodes::core::PointInPolygonJoinNode>("PointInPolygonJoin");
+  R_core->register_node<nodes::core::SpatialSortNode>("SpatialSort");
+  R_core->register_node<nodes::core::TilePartitionerNode>("TilePartitioner");
   R_core->register_node<nodes::core::BoxNode>("Box");
   node_registers.emplace(R_core);
 
@@ -115,13 +128,31 @@ void print_nodes(NodeRegisterMap& node_registers) {
   }
 }
 
+// parse a size in bytes with an optional K, M, G or T suffix (powers of 1024)
+bool parse_memory_size(const std::string& text, size_t& bytes) {
+  std::stringstream ss(text);
+  double value;
+  if (!(ss >> value) || value < 0) return false;
+  std::string suffix;
+  ss >> suffix;
+  if (!suffix.empty() && (suffix.back() == 'B' || suffix.back() == 'b')) suffix.pop_back();
+  double factor = 1;
+  if (suffix == "K" || suffix == "k") factor = 1024.;
+  else if (suffix == "M" || suffix == "m") factor = 1024.*1024;
+  else if (suffix == "G" || suffix == "g") factor = 1024.*1024*1024;
+  else if (suffix == "T" || suffix == "t") factor = 1024.*1024*1024*1024;
+  else if (!suffix.empty()) return false;
+  bytes = size_t(value * factor);
+  return true;
+}
+
 void print_help(std::string program_name) {
   // see http://docopt.org/
   std::cout << "Usage: \n";
   std::cout << "   " << program_name;
   std::cout << " [-v|-p|-n|-h]\n";
   std::cout << "   " << program_name;
-  std::cout << " <flowchart_file> [-V] [-g] [-w] [-c <file>] [--GLOBAL1=A --GLOBAL2=B ...]\n";
+  std::cout << " <flowchart_file> [-V] [-g] [-w] [-c <file>] [--history <file>] [-j <n>] [--memory-budget <size>] [--explain [<file>]] [--GLOBAL1=A --GLOBAL2=B ...]\n";
   std::cout << "\n";
   std::cout << "Options:\n";
   std::cout << "   -v, --version                Print version information\n";
@@ -134,6 +165,10 @@ void print_help(std::string program_name) {
   std::cout << "   -g, --list-globals           List available flowchart globals. Cancels flowchart execution\n";
   std::cout << "   -w, --workdir                Set working directory to folder containing flowchart file\n";
   std::cout << "   -c <file>, --config <file>   Read globals from TOML config file\n";
+  std::cout << "   --history <file>             Read and update node runtimes in JSON file, used to schedule nodes on the critical path first\n";
+  std::cout << "   -j <n>, --jobs <n>           Process up to n independent nodes at the same time. Defaults to the number of cores if a memory budget is set, otherwise to 1\n";
+  std::cout << "   --memory-budget <size>       Only start a node if the memory estimates of the running nodes stay within size, eg. 512M or 48G\n";
+  std::cout << "   --explain [<file>]           Print the execution plan without running the flowchart, or write it to a .txt, .dot or .json file\n";
   std::cout << "   --GLOBAL1=A --GLOBAL2=B ...  Specify globals for flowchart (list availale globals with -g)\n";
 }
 
@@ -149,7 +184,7 @@ int main(int argc, const char * argv[]) {
     std::cout << "Detected environment variable GF_PLUGIN_FOLDER = " << plugin_folder << "\n";
   }
 
-  auto cmdl = argh::parser({ "-c", "--config" });
+  auto cmdl = argh::parser({ "-c", "--config", "--history", "-j", "--jobs", "--memory-budget", "--explain" });
   cmdl.parse(argc, argv);
   std::string program_name = cmdl[0];
 
@@ -289,7 +324,7 @@ int main(int argc, const char * argv[]) {
         }
       }
       for (auto& [key, value] : cmdl.params()) {
-        if (key == "c" || key == "config") continue;
+        if (key == "c" || key == "config" || key == "history" || key == "j" || key == "jobs" || key == "memory-budget" || key == "explain") continue;
         
         if (flowchart.global_flowchart_params.find(key) == flowchart.global_flowchart_params.end()) {
           std::clog << "WARNING: no such global parameter: " << key << " (use -g to view available globals)\n";
@@ -331,6 +366,55 @@ int main(int argc, const char * argv[]) {
 
     if( ! list_globals ) {
 
+      std::string memory_budget;
+      if (cmdl("--memory-budget") >> memory_budget) {
+        if (!parse_memory_size(memory_budget, flowchart.memory_budget)) {
+          std::cerr << "ERROR: invalid memory budget: " << memory_budget << "\n";
+          print_help(program_name);
+          return EXIT_FAILURE;
+        }
+        flowchart.max_jobs = std::max(1u, std::thread::hardware_concurrency());
+      }
+      // jobs is seen as flag because there is no value provided
+      if (cmdl[{"-j", "--jobs"}]) {
+        std::cerr << "ERROR: no number of jobs provided\n";
+        print_help(program_name);
+        return EXIT_FAILURE;
+      }
+      if (cmdl({"-j", "--jobs"})) {
+        int jobs;
+        if (!(cmdl({"-j", "--jobs"}) >> jobs) || jobs < 1) {
+          std::cerr << "ERROR: invalid number of jobs: " << cmdl({"-j", "--jobs"}).str() << "\n";
+          print_help(program_name);
+          return EXIT_FAILURE;
+        }
+        flowchart.max_jobs = jobs;
+      }
+
+      std::string history_path;
+      if (cmdl("--history") >> history_path) {
+        flowchart.run_history = std::make_shared<RunHistory>(fs::absolute(history_path).string());
+        flowchart.run_history->load();
+      }
+
+      if (cmdl["--explain"] || cmdl("--explain")) {
+        std::string explain_path;
+        try {
+          ExecutionPlan plan(flowchart);
+          if (cmdl("--explain") >> explain_path) {
+            plan.write(explain_path);
+          } else {
+            // print regardless of verbosity
+            std::cout.clear();
+            plan.write_text(std::cout);
+          }
+        } catch (const gfException& e) {
+          std::cerr << "ERROR: " << e.what() << "\n";
+          return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+      }
+
       // launch gui or just run the flowchart in cli mode
       if(cmdl[{"-w", "--workdir"}]) fs::current_path(flowchart_folder);
       #ifdef GF_BUILD_WITH_GUI
@@ -353,6 +437,13 @@ int main(int argc, const char * argv[]) {
         }
       #endif
       fs::current_path(launch_path);
+      if (flowchart.run_history) flowchart.run_history->save();
+      flowchart.print_run_report(std::cout);
+      auto expr_stats = getExpressionCacheStats();
+      if (size_t lookups = expr_stats.hits + expr_stats.misses) {
+        std::cout << "Expression cache: " << expr_stats.hits << " hits, " << expr_stats.misses << " misses ("
+                  << (100 * expr_stats.hits / lookups) << "% hit rate)\n";
+      }
 
       
     }
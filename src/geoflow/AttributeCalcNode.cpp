@@ -3,72 +3,187 @@
 
 namespace geoflow::nodes::core {
 
-  void FloatExprNode::process(){
-    auto computer = createExpressionComputer();
+  // Attribute columns bound to "a." symbols of an expression computer, the row values are written straight into the
+  // variables of the computer
+  class AttributeColumns {
+    enum ColumnType { FLOAT_COLUMN, INT_COLUMN, BOOL_COLUMN, STRING_COLUMN, OTHER_COLUMN };
+    struct InputColumn {
+      ColumnType type;
+      const std::vector<std::any>& data;
+      std::string symbol_name;
+    };
+    std::vector<InputColumn> columns_;
+
+    public:
+    // add a symbol for every sub terminal of attributes to spec
+    AttributeColumns(gfMultiFeatureInputTerminal& attributes, ExpressionComputerSpec& spec) {
+      for (auto& iterm : attributes.sub_terminals()) {
+        ColumnType type = OTHER_COLUMN;
+        if(iterm->accepts_type(typeid(std::string))) {
+          spec.add_symbol(iterm->get_full_name(), "a.", "");
+          type = STRING_COLUMN;
+        } else {
+          spec.add_symbol(iterm->get_full_name(), "a.", 0);
+          if (iterm->accepts_type(typeid(float))) type = FLOAT_COLUMN;
+          else if (iterm->accepts_type(typeid(int))) type = INT_COLUMN;
+          else if (iterm->accepts_type(typeid(bool))) type = BOOL_COLUMN;
+        }
+        columns_.push_back({type, iterm->get_data_vec(), "a." + iterm->get_full_name()});
+      }
+    };
 
-    computer->add_symbols(manager);
-    computer->add_expression("result", expr_string_);
+    // binds the columns to one computer, every thread should use its own computer and binding
+    class Binding {
+      const std::vector<InputColumn>& columns_;
+      std::vector<float*> values_;
+      std::vector<std::string*> str_values_;
 
-    output("value").set(computer->eval("result"));
+      public:
+      Binding(const std::vector<InputColumn>& columns, ExpressionComputerInterface& computer) : columns_(columns) {
+        for (auto& column : columns_) {
+          values_.push_back(computer.get_symbol_ptr(column.symbol_name));
+          str_values_.push_back(computer.get_string_symbol_ptr(column.symbol_name));
+        }
+      };
+      // set the symbols to the values of row i
+      void set_row(size_t i) {
+        for (size_t j=0; j<columns_.size(); ++j) {
+          auto& data = columns_[j].data;
+          switch (columns_[j].type) {
+            case FLOAT_COLUMN: *values_[j] = std::any_cast<float>(data[i]); break;
+            case INT_COLUMN: *values_[j] = float(std::any_cast<int>(data[i])); break;
+            case BOOL_COLUMN: *values_[j] = float(std::any_cast<bool>(data[i])); break;
+            case STRING_COLUMN: *str_values_[j] = std::any_cast<const std::string&>(data[i]); break;
+            case OTHER_COLUMN: break;
+          }
+        }
+      };
+    };
+    Binding bind(ExpressionComputerInterface& computer) const { return Binding(columns_, computer); };
+  };
+
+  // number of workers of the shared executor to use for n rows
+  static size_t expression_workers(size_t n) {
+    const size_t min_rows_per_worker = 10000;
+    return std::max<size_t>(1, std::min(get_concurrency(), n / min_rows_per_worker));
+  }
+
+  void FloatExprNode::process(){
+    ExpressionComputerSpec spec;
+    spec.add_symbols(manager);
+    spec.add_expression("result", expr_string_);
+    auto computer = acquireExpressionComputer(spec);
+
+    value_output_.set(computer->eval("result"));
   };
 
   void AttributeCalcNode::process() {
 
-    auto computer = createExpressionComputer();
+    // the computers are taken from the expression cache, so that the expressions are not compiled again when the node
+    // runs again with the same attributes (eg. for every item in a NestNode)
+    ExpressionComputerSpec spec;
 
-    computer->add_symbols(manager);
+    spec.add_symbols(manager);
+
+    auto& input_attributes = poly_input("attributes");
+    auto& output_attributes = poly_output("attributes");
+    size_t isize = input_attributes.size();
 
     // add input attributes
-    for (auto& iterm : poly_input("attributes").sub_terminals()) {
-      if(iterm->accepts_type(typeid(std::string))) {
-        computer->add_symbol(iterm->get_full_name(), "a.", "");
-      } else {
-        computer->add_symbol(iterm->get_full_name(), "a.", 0);
-      }
-    }
+    AttributeColumns input_columns(input_attributes, spec);
 
     if(as_string_) {
-      computer->add_str_result_symbol();
+      spec.add_str_result_symbol();
     }
     
+    // allocate an output column for every expression, expressions are indexed in the order they were added
+    struct OutputColumn {
+      size_t expression;
+      std::vector<std::any>& data;
+    };
+    std::vector<OutputColumn> output_columns;
     for(auto& [name, expr_str] : attribute_expressions) {
-      computer->add_expression(name, expr_str);
+      spec.add_expression(name, expr_str);
+      auto& oterm = as_string_ ? output_attributes.add_vector(name, typeid(std::string)) : output_attributes.add_vector(name, typeid(float));
       if(as_string_) {
-        poly_output("attributes").add_vector(name, typeid(std::string));
+        oterm.resize<std::string>(isize);
       } else {
-        poly_output("attributes").add_vector(name, typeid(float));
+        oterm.resize<float>(isize);
       }
+      oterm.touch();
+      output_columns.push_back({output_columns.size(), oterm.get_data_vec()});
     }
     
-    size_t isize = poly_input("attributes").size();
-    // std::cout << "Expression results:" << std::endl;
-    for(size_t i=0; i<isize; ++i) {
-      // assign input attributes
-      for (auto& iterm : poly_input("attributes").sub_terminals()) {
-        std::string name = "a." + iterm->get_full_name();
-        if (iterm->accepts_type(typeid(float))) {
-          computer->set_symbol(name, iterm->get<float>(i));
-        } else if (iterm->accepts_type(typeid(int))) {
-          computer->set_symbol(name, float(iterm->get<int>(i)));
-        } else if (iterm->accepts_type(typeid(bool))) {
-          computer->set_symbol(name, float(iterm->get<bool>(i)));
-        } else if (iterm->accepts_type(typeid(std::string))) {
-          computer->set_symbol(name, iterm->get<std::string>(i));
-        }
-      }  
-      
-      for(auto& [name, expr] : attribute_expressions) {
-        // assign expression vars/consts
-        // evaluate expression
-        // push result to output
-        // std::cout << result << std::endl;
-        if(as_string_) {
-          poly_output("attributes").sub_terminal(name).push_back(computer->eval_str(name));
-        } else {
-          poly_output("attributes").sub_terminal(name).push_back(float(computer->eval(name)));
+    // evaluate the rows in [begin, end)
+    auto evaluate_rows = [&](ExpressionComputerInterface& computer, size_t begin, size_t end) {
+      auto binding = input_columns.bind(computer);
+      for(size_t i=begin; i<end; ++i) {
+        binding.set_row(i);
+        
+        for(auto& column : output_columns) {
+          if(as_string_) {
+            column.data[i] = computer.eval_str(column.expression);
+          } else {
+            column.data[i] = float(computer.eval(column.expression));
+          }
         }
       }
+    };
+
+    // split the rows in equal ranges over the workers of the shared executor, each with its own computer. Every row is
+    // written to its own preallocated slot, so the result is the same as evaluating sequentially.
+    size_t n_workers = expression_workers(isize);
+    std::vector<PooledExpressionComputer> computers;
+    for (size_t w=0; w<n_workers; ++w) {
+      computers.push_back(acquireExpressionComputer(spec));
+    }
+    parallel_invoke(n_workers, [&](size_t w) {
+      evaluate_rows(*computers[w], isize * w / n_workers, isize * (w+1) / n_workers);
+    });
+  };
+
+
+  void FilterNode::process() {
+    ExpressionComputerSpec spec;
+    spec.add_symbols(manager);
+
+    auto& input_attributes = poly_input("attributes");
+    size_t isize = input_attributes.size();
+    AttributeColumns input_columns(input_attributes, spec);
+    spec.add_expression("filter", expression_);
+
+    // rows to evaluate, with a connected selection input only its rows are considered
+    const Selection* input_selection = nullptr;
+    if (selection_input_.has_data()) {
+      input_selection = &selection_input_.get();
+      if (input_selection->source_size() != isize)
+        throw gfNodeInputDataError("selection input is for " + std::to_string(input_selection->source_size()) + " rows, but there are " + std::to_string(isize) + " attribute rows");
+    }
+    size_t n_candidates = input_selection ? input_selection->size() : isize;
+
+    // every worker collects the selected rows of its own range of candidates, the ranges are concatenated in order so
+    // that the rows stay sorted
+    size_t n_workers = expression_workers(n_candidates);
+    std::vector<PooledExpressionComputer> computers;
+    for (size_t w=0; w<n_workers; ++w) {
+      computers.push_back(acquireExpressionComputer(spec));
+    }
+    std::vector<std::vector<size_t>> worker_rows(n_workers);
+    parallel_invoke(n_workers, [&](size_t w) {
+      auto binding = input_columns.bind(*computers[w]);
+      size_t filter = computers[w]->get_expression_index("filter");
+      for (size_t c = n_candidates * w / n_workers; c < n_candidates * (w+1) / n_workers; ++c) {
+        size_t i = input_selection ? (*input_selection)[c] : c;
+        binding.set_row(i);
+        if (computers[w]->eval(filter) != 0) worker_rows[w].push_back(i);
+      }
+    });
+
+    std::vector<size_t> rows = std::move(worker_rows[0]);
+    for (size_t w=1; w<n_workers; ++w) {
+      rows.insert(rows.end(), worker_rows[w].begin(), worker_rows[w].end());
     }
+    selection_output_.set(Selection(std::move(rows), isize));
   };
 
-}
\ No newline at end of file
+}
@@ -1,4 +1,5 @@
 #include "exprtk.hpp"
+#include <mutex>
 #include <unordered_map>
 #include "ExpressionComputer.hpp"
 
@@ -16,7 +17,8 @@ namespace geoflow {
 
     std::unordered_map<std::string, float> symbols;
     std::unordered_map<std::string, std::string> string_symbols;
-    std::unordered_map<std::string, expression_t> expressions;
+    std::vector<expression_t> expressions;
+    std::unordered_map<std::string, size_t> expression_indices;
 
     void add_expression(const std::string& name, const std::string& expr_str) override {
       expression_t expression;
@@ -25,7 +27,13 @@ namespace geoflow {
       {
           throw gfException("Exprtk could not compile expression: " + expr_str);
       }
-      expressions.insert({name, expression});
+      auto it = expression_indices.find(name);
+      if (it != expression_indices.end()) {
+        expressions[it->second] = expression;
+      } else {
+        expression_indices[name] = expressions.size();
+        expressions.push_back(expression);
+      }
 
     };
 
@@ -42,20 +50,13 @@ namespace geoflow {
     };
     
     void add_symbols(NodeManager& manager) override {
-      for (auto& [key,param_ptr] : manager.global_flowchart_params) {
-        if(param_ptr->is_type(typeid(int))){
-          float val = static_cast<ParameterByValue<int>*>(param_ptr.get())->get();
-          add_symbol(key, "g.", val);
-        } else if(param_ptr->is_type(typeid(float))){
-          float val = static_cast<ParameterByValue<float>*>(param_ptr.get())->get();
-          add_symbol(key, "g.", val);
-        } else if(param_ptr->is_type(typeid(bool))){
-          float val = static_cast<ParameterByValue<bool>*>(param_ptr.get())->get();
-          add_symbol(key, "g.", val);
-        } else if(param_ptr->is_type(typeid(std::string))){
-          auto* val = static_cast<ParameterByValue<std::string>*>(param_ptr.get());
-          add_symbol(key, "g.", val->get()); // or use add_constants ?
-        }
+      ExpressionComputerSpec spec;
+      spec.add_symbols(manager);
+      for (auto& [name, value] : spec.symbols) {
+        add_symbol(name, "", value);
+      }
+      for (auto& [name, value] : spec.string_symbols) {
+        add_symbol(name, "", value);
       }
     };
 
@@ -69,10 +70,31 @@ namespace geoflow {
     // T& get_symbol(name);
 
     float eval(const std::string& name) override {
-      return expressions[name].value();
+      return eval(get_expression_index(name));
     };
     std::string eval_str(const std::string& name) override {
-      expressions[name].value();
+      return eval_str(get_expression_index(name));
+    };
+
+    float* get_symbol_ptr(const std::string& name) override {
+      auto it = symbols.find(name);
+      return it == symbols.end() ? nullptr : &it->second;
+    };
+    std::string* get_string_symbol_ptr(const std::string& name) override {
+      auto it = string_symbols.find(name);
+      return it == string_symbols.end() ? nullptr : &it->second;
+    };
+    size_t get_expression_index(const std::string& name) override {
+      auto it = expression_indices.find(name);
+      if (it == expression_indices.end())
+        throw gfException("No such expression: " + name);
+      return it->second;
+    };
+    float eval(size_t expression_index) override {
+      return expressions[expression_index].value();
+    };
+    std::string& eval_str(size_t expression_index) override {
+      expressions[expression_index].value();
       return str_result_;
     };
   
@@ -82,4 +104,102 @@ namespace geoflow {
     return std::make_unique<ExpressionComputer>();
   };
 
+  void ExpressionComputerSpec::add_symbol(const std::string& name, const std::string& prefix, float value) {
+    symbols.push_back({prefix+name, value});
+  }
+  void ExpressionComputerSpec::add_symbol(const std::string& name, const std::string& prefix, std::string value) {
+    string_symbols.push_back({prefix+name, value});
+  }
+  void ExpressionComputerSpec::add_str_result_symbol() {
+    str_result_symbol = true;
+  }
+  void ExpressionComputerSpec::add_symbols(NodeManager& manager) {
+    for (auto& [key,param_ptr] : manager.global_flowchart_params) {
+      if(param_ptr->is_type(typeid(int))){
+        float val = static_cast<ParameterByValue<int>*>(param_ptr.get())->get();
+        add_symbol(key, "g.", val);
+      } else if(param_ptr->is_type(typeid(float))){
+        float val = static_cast<ParameterByValue<float>*>(param_ptr.get())->get();
+        add_symbol(key, "g.", val);
+      } else if(param_ptr->is_type(typeid(bool))){
+        float val = static_cast<ParameterByValue<bool>*>(param_ptr.get())->get();
+        add_symbol(key, "g.", val);
+      } else if(param_ptr->is_type(typeid(std::string))){
+        auto* val = static_cast<ParameterByValue<std::string>*>(param_ptr.get());
+        add_symbol(key, "g.", val->get());
+      }
+    }
+  }
+  void ExpressionComputerSpec::add_expression(const std::string& name, const std::string& expr_string) {
+    expressions.push_back({name, expr_string});
+  }
+  std::string ExpressionComputerSpec::layout_key() const {
+    // names can not contain the separator characters
+    std::string key;
+    for (auto& [name, value] : symbols) key += "f:" + name + "\n";
+    for (auto& [name, value] : string_symbols) key += "s:" + name + "\n";
+    if (str_result_symbol) key += "str_result\n";
+    for (auto& [name, expr_string] : expressions) key += "e:" + name + "\n" + expr_string + "\x1f";
+    return key;
+  }
+
+  // released computers by layout key
+  static std::mutex cache_mutex_;
+  static std::unordered_map<std::string, std::vector<std::unique_ptr<ExpressionComputerInterface>>> cache_;
+  static size_t n_cached_ = 0;
+  static const size_t max_cached_computers_ = 256;
+  static ExpressionCacheStats cache_stats_;
+
+  PooledExpressionComputer acquireExpressionComputer(const ExpressionComputerSpec& spec) {
+    auto key = spec.layout_key();
+    std::unique_ptr<ExpressionComputerInterface> computer;
+    {
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      auto it = cache_.find(key);
+      if (it != cache_.end() && !it->second.empty()) {
+        computer = std::move(it->second.back());
+        it->second.pop_back();
+        --n_cached_;
+        ++cache_stats_.hits;
+      } else {
+        ++cache_stats_.misses;
+      }
+    }
+    if (computer) {
+      for (auto& [name, value] : spec.symbols) {
+        *computer->get_symbol_ptr(name) = value;
+      }
+      for (auto& [name, value] : spec.string_symbols) {
+        *computer->get_string_symbol_ptr(name) = value;
+      }
+    } else {
+      computer = createExpressionComputer();
+      for (auto& [name, value] : spec.symbols) {
+        computer->add_symbol(name, "", value);
+      }
+      for (auto& [name, value] : spec.string_symbols) {
+        computer->add_symbol(name, "", value);
+      }
+      if (spec.str_result_symbol) {
+        computer->add_str_result_symbol();
+      }
+      for (auto& [name, expr_string] : spec.expressions) {
+        computer->add_expression(name, expr_string);
+      }
+    }
+    return PooledExpressionComputer(computer.release(), [key](ExpressionComputerInterface* released) {
+      std::unique_ptr<ExpressionComputerInterface> owned(released);
+      std::lock_guard<std::mutex> lock(cache_mutex_);
+      if (n_cached_ < max_cached_computers_) {
+        cache_[key].push_back(std::move(owned));
+        ++n_cached_;
+      }
+    });
+  }
+
+  ExpressionCacheStats getExpressionCacheStats() {
+    std::lock_guard<std::mutex> lock(cache_mutex_);
+    return cache_stats_;
+  }
+
 }
\ No newline at end of file
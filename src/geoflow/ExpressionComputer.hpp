@@ -1,3 +1,7 @@
+#pragma once
+
+#include <functional>
+
 #include "geoflow.hpp"
 
 namespace geoflow {
@@ -16,7 +20,45 @@ namespace geoflow {
   virtual float eval(const std::string& name) = 0;
   virtual std::string eval_str(const std::string& name) = 0;
 
+  // Direct access for evaluating many rows: write the row values straight into the variables that the expressions are
+  // bound to and evaluate expressions by index, without any lookups by name.
+  // pointer to the variable of a symbol (including its prefix), nullptr if there is no such symbol
+  virtual float* get_symbol_ptr(const std::string& name) = 0;
+  virtual std::string* get_string_symbol_ptr(const std::string& name) = 0;
+  virtual size_t get_expression_index(const std::string& name) = 0;
+  virtual float eval(size_t expression_index) = 0;
+  virtual std::string& eval_str(size_t expression_index) = 0;
+
   };
 
   std::unique_ptr<ExpressionComputerInterface> createExpressionComputer();
+
+  // Symbols, with their values, and expressions to build an ExpressionComputer from. Symbol names include their prefix.
+  struct ExpressionComputerSpec {
+    std::vector<std::pair<std::string, float>> symbols;
+    std::vector<std::pair<std::string, std::string>> string_symbols;
+    bool str_result_symbol = false;
+    std::vector<std::pair<std::string, std::string>> expressions;
+
+    void add_symbol(const std::string& name, const std::string& prefix, float value=0);
+    void add_symbol(const std::string& name, const std::string& prefix, std::string value="");
+    void add_str_result_symbol();
+    // globals of manager with prefix "g."
+    void add_symbols(NodeManager& manager);
+    void add_expression(const std::string& name, const std::string& expr_string);
+    // identifies the compiled expressions: symbol names and types and the expressions, but not the symbol values
+    std::string layout_key() const;
+  };
+
+  typedef std::unique_ptr<ExpressionComputerInterface, std::function<void(ExpressionComputerInterface*)>> PooledExpressionComputer;
+  // Computer for spec, taken from a process wide cache of compiled computers when one with the same layout_key was
+  // released before, in which case only the symbol values are set. Otherwise a new computer is built and compiled. The
+  // computer goes back into the cache when the returned pointer is destroyed, so it is only ever used by one owner.
+  PooledExpressionComputer acquireExpressionComputer(const ExpressionComputerSpec& spec);
+
+  struct ExpressionCacheStats {
+    size_t hits = 0;
+    size_t misses = 0;
+  };
+  ExpressionCacheStats getExpressionCacheStats();
 }
\ No newline at end of file
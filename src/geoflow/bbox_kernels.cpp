@@ -0,0 +1,153 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define GF_BBOX_SSE2
+#endif
+// the avx2 kernel relies on the target attribute for runtime dispatch, so it is limited to gcc and clang
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+  #include <immintrin.h>
+  #define GF_BBOX_AVX2
+#endif
+
+#include "bbox_kernels.hpp"
+#include "parallel.hpp"
+
+namespace geoflow {
+
+  typedef std::array<float, 3> arr3;
+
+  static void reduce_scalar(const float* xyz, size_t n, arr3& pmin, arr3& pmax) {
+    for (size_t i = 0; i < n; ++i) {
+      const float* p = xyz + 3*i;
+      for (size_t c = 0; c < 3; ++c) {
+        pmin[c] = std::min(pmin[c], p[c]);
+        pmax[c] = std::max(pmax[c], p[c]);
+      }
+    }
+  }
+
+  // lanes of the vector accumulators hold x,y,z,x,y,z,..., fold them into pmin and pmax
+  static void fold_lanes(const float* lo, const float* hi, size_t n_lanes, arr3& pmin, arr3& pmax) {
+    for (size_t k = 0; k < n_lanes; ++k) {
+      pmin[k%3] = std::min(pmin[k%3], lo[k]);
+      pmax[k%3] = std::max(pmax[k%3], hi[k]);
+    }
+  }
+
+#ifdef GF_BBOX_SSE2
+  // 4 points (12 floats, 3 registers) per iteration
+  static void reduce_sse2(const float* xyz, size_t n, arr3& pmin, arr3& pmax) {
+    size_t n_vec = n - n%4;
+    if (n_vec) {
+      __m128 mn0 = _mm_loadu_ps(xyz), mn1 = _mm_loadu_ps(xyz+4), mn2 = _mm_loadu_ps(xyz+8);
+      __m128 mx0 = mn0, mx1 = mn1, mx2 = mn2;
+      for (size_t i = 4; i < n_vec; i += 4) {
+        const float* p = xyz + 3*i;
+        __m128 a = _mm_loadu_ps(p), b = _mm_loadu_ps(p+4), c = _mm_loadu_ps(p+8);
+        mn0 = _mm_min_ps(mn0, a); mn1 = _mm_min_ps(mn1, b); mn2 = _mm_min_ps(mn2, c);
+        mx0 = _mm_max_ps(mx0, a); mx1 = _mm_max_ps(mx1, b); mx2 = _mm_max_ps(mx2, c);
+      }
+      float lo[12], hi[12];
+      _mm_storeu_ps(lo, mn0); _mm_storeu_ps(lo+4, mn1); _mm_storeu_ps(lo+8, mn2);
+      _mm_storeu_ps(hi, mx0); _mm_storeu_ps(hi+4, mx1); _mm_storeu_ps(hi+8, mx2);
+      fold_lanes(lo, hi, 12, pmin, pmax);
+    }
+    reduce_scalar(xyz + 3*n_vec, n - n_vec, pmin, pmax);
+  }
+#endif
+
+#ifdef GF_BBOX_AVX2
+  // 8 points (24 floats, 3 registers) per iteration
+  __attribute__((target("avx2")))
+  static void reduce_avx2(const float* xyz, size_t n, arr3& pmin, arr3& pmax) {
+    size_t n_vec = n - n%8;
+    if (n_vec) {
+      __m256 mn0 = _mm256_loadu_ps(xyz), mn1 = _mm256_loadu_ps(xyz+8), mn2 = _mm256_loadu_ps(xyz+16);
+      __m256 mx0 = mn0, mx1 = mn1, mx2 = mn2;
+      for (size_t i = 8; i < n_vec; i += 8) {
+        const float* p = xyz + 3*i;
+        __m256 a = _mm256_loadu_ps(p), b = _mm256_loadu_ps(p+8), c = _mm256_loadu_ps(p+16);
+        mn0 = _mm256_min_ps(mn0, a); mn1 = _mm256_min_ps(mn1, b); mn2 = _mm256_min_ps(mn2, c);
+        mx0 = _mm256_max_ps(mx0, a); mx1 = _mm256_max_ps(mx1, b); mx2 = _mm256_max_ps(mx2, c);
+      }
+      float lo[24], hi[24];
+      _mm256_storeu_ps(lo, mn0); _mm256_storeu_ps(lo+8, mn1); _mm256_storeu_ps(lo+16, mn2);
+      _mm256_storeu_ps(hi, mx0); _mm256_storeu_ps(hi+8, mx1); _mm256_storeu_ps(hi+16, mx2);
+      fold_lanes(lo, hi, 24, pmin, pmax);
+    }
+    reduce_scalar(xyz + 3*n_vec, n - n_vec, pmin, pmax);
+  }
+#endif
+
+  typedef void (*reduce_kernel)(const float*, size_t, arr3&, arr3&);
+  struct Kernel {
+    reduce_kernel fn;
+    const char* name;
+  };
+
+  static Kernel select_kernel() {
+  #ifdef GF_BBOX_AVX2
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return {reduce_avx2, "avx2"};
+  #endif
+  #ifdef GF_BBOX_SSE2
+    return {reduce_sse2, "sse2"};
+  #else
+    return {reduce_scalar, "scalar"};
+  #endif
+  }
+
+  static const Kernel& kernel() {
+    static const Kernel k = select_kernel();
+    return k;
+  }
+
+  void bbox_reduce(const float* xyz, size_t n, arr3& pmin, arr3& pmax) {
+    kernel().fn(xyz, n, pmin, pmax);
+  }
+
+  // below this many points per task the threading overhead outweighs the gain
+  static const size_t min_points_per_task = 1 << 20;
+
+  void bbox_reduce_parallel(const float* xyz, size_t n, arr3& pmin, arr3& pmax) {
+    size_t n_tasks = std::min(get_concurrency(), n / min_points_per_task);
+    if (n_tasks <= 1) return bbox_reduce(xyz, n, pmin, pmax);
+
+    std::vector<arr3> mins(n_tasks), maxs(n_tasks);
+    parallel_invoke(n_tasks, [&](size_t t) {
+      size_t begin = n * t / n_tasks, end = n * (t+1) / n_tasks;
+      const float* first = xyz + 3*begin;
+      mins[t] = {first[0], first[1], first[2]};
+      maxs[t] = mins[t];
+      bbox_reduce(first, end - begin, mins[t], maxs[t]);
+    });
+    for (size_t t = 0; t < n_tasks; ++t) {
+      for (size_t c = 0; c < 3; ++c) {
+        pmin[c] = std::min(pmin[c], mins[t][c]);
+        pmax[c] = std::max(pmax[c], maxs[t][c]);
+      }
+    }
+  }
+
+  const char* bbox_kernel_name() {
+    return kernel().name;
+  }
+}
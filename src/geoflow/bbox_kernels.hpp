@@ -0,0 +1,33 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+
+namespace geoflow {
+
+  // Bounding box reduction over n points stored as consecutive x,y,z floats.
+  // pmin and pmax are only tightened, so the caller initialises them (eg. to
+  // the first point). The fastest kernel supported by the CPU (avx2, sse2 or
+  // scalar) is selected at runtime. NaN coordinates are not supported.
+  void bbox_reduce(const float* xyz, size_t n, std::array<float, 3>& pmin, std::array<float, 3>& pmax);
+  // Same as bbox_reduce, but large inputs are split over the workers of the shared executor
+  void bbox_reduce_parallel(const float* xyz, size_t n, std::array<float, 3>& pmin, std::array<float, 3>& pmax);
+  // name of the kernel selected by bbox_reduce
+  const char* bbox_kernel_name();
+}
@@ -15,9 +15,19 @@
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <algorithm>
+#include <cmath>
+#include <cstring>
 #include <iomanip>
+#include <limits>
+#include <stdexcept>
+
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define GF_QUANTIZE_SSE2
+#endif
 
 #include "common.hpp"
+#include "bbox_kernels.hpp"
 
 namespace geoflow
 {
@@ -99,13 +109,23 @@ void Box::add(Box &otherBox)
 }
 void Box::add(vec3f &vec)
 {
-  for (auto &p : vec)
-    add(p);
+  if (!vec.empty())
+    add(vec[0].data(), vec.size());
 }
 void Box::add(const vec3f &vec)
 {
-  for (auto &p : vec)
-    add(p);
+  if (!vec.empty())
+    add(vec[0].data(), vec.size());
+}
+void Box::add(const float *xyz, size_t n)
+{
+  if (n == 0)
+    return;
+  arr3f nmin = {xyz[0], xyz[1], xyz[2]};
+  arr3f nmax = nmin;
+  bbox_reduce_parallel(xyz, n, nmin, nmax);
+  add(nmin);
+  add(nmax);
 }
 float Box::size_x() const
 {
@@ -144,6 +164,10 @@ const Box &Geometry::box()
   }
   return *bbox;
 };
+void Geometry::invalidate_box()
+{
+  bbox.reset();
+}
 size_t Geometry::dimension()
 {
   return 3;
@@ -175,10 +199,7 @@ void LinearRing::compute_box()
   if (!bbox.has_value())
   {
     bbox = Box();
-    for (auto &t : *this)
-    {
-      bbox->add(t);
-    }
+    bbox->add(*this);
   }
 }
 float LinearRing::signed_area() const
@@ -233,10 +254,7 @@ void LineString::compute_box()
   if (!bbox.has_value())
   {
     bbox = Box();
-    for (auto &t : *this)
-    {
-      bbox->add(t);
-    }
+    bbox->add(*this);
   }
 }
 size_t LineString::vertex_count() const
@@ -265,6 +283,166 @@ float *PointCollection::get_data_ptr()
   return (*this)[0].data();
 }
 
+QuantizedPointCollection::QuantizedPointCollection(arr3d scale, arr3d offset) : scale_(scale), offset_(offset) {}
+
+static int32_t quantize_value(double v, double scale, double offset)
+{
+  double q = std::round((v - offset) / scale);
+  if (!(q >= double(std::numeric_limits<int32_t>::min()) && q <= double(std::numeric_limits<int32_t>::max())))
+    throw std::out_of_range("coordinate " + std::to_string(v) + " can not be quantised with scale " + std::to_string(scale) + " and offset " + std::to_string(offset));
+  return int32_t(q);
+}
+
+QuantizedPointCollection QuantizedPointCollection::quantize(const PointCollection &points, arr3d scale, arr3d offset, const arr3d &origin)
+{
+  QuantizedPointCollection result(scale, offset);
+  result.reserve(points.size());
+  for (auto &p : points)
+  {
+    result.push_back(arr3d{origin[0] + p[0], origin[1] + p[1], origin[2] + p[2]});
+  }
+  result.get_attributes() = points.get_attributes();
+  return result;
+}
+size_t QuantizedPointCollection::size() const
+{
+  return points_.size();
+}
+bool QuantizedPointCollection::empty() const
+{
+  return points_.empty();
+}
+void QuantizedPointCollection::reserve(size_t n)
+{
+  points_.reserve(n);
+}
+void QuantizedPointCollection::clear()
+{
+  points_.clear();
+  get_attributes().clear();
+}
+const arr3d &QuantizedPointCollection::scale() const
+{
+  return scale_;
+}
+const arr3d &QuantizedPointCollection::offset() const
+{
+  return offset_;
+}
+std::vector<arr3i> &QuantizedPointCollection::quantized()
+{
+  return points_;
+}
+const std::vector<arr3i> &QuantizedPointCollection::quantized() const
+{
+  return points_;
+}
+void QuantizedPointCollection::push_back(const arr3i &q)
+{
+  points_.push_back(q);
+}
+void QuantizedPointCollection::push_back(const arr3d &p)
+{
+  points_.push_back({quantize_value(p[0], scale_[0], offset_[0]),
+                     quantize_value(p[1], scale_[1], offset_[1]),
+                     quantize_value(p[2], scale_[2], offset_[2])});
+}
+arr3d QuantizedPointCollection::coordinate(size_t i) const
+{
+  auto &q = points_[i];
+  return {offset_[0] + scale_[0] * q[0], offset_[1] + scale_[1] * q[1], offset_[2] + scale_[2] * q[2]};
+}
+
+void QuantizedPointCollection::decode(arr3f *result, size_t begin, size_t n, const arr3d &origin) const
+{
+  if (n == 0)
+    return;
+  const int32_t *q = points_[begin].data();
+  float *out = result->data();
+  const double s[3] = {scale_[0], scale_[1], scale_[2]};
+  const double o[3] = {offset_[0] - origin[0], offset_[1] - origin[1], offset_[2] - origin[2]};
+  size_t k = 0, n_values = 3 * n;
+#ifdef GF_QUANTIZE_SSE2
+  // two points (6 values) per iteration, the scale and offset pattern repeats every 3 values
+  const __m128d s0 = _mm_setr_pd(s[0], s[1]), s1 = _mm_setr_pd(s[2], s[0]), s2 = _mm_setr_pd(s[1], s[2]);
+  const __m128d o0 = _mm_setr_pd(o[0], o[1]), o1 = _mm_setr_pd(o[2], o[0]), o2 = _mm_setr_pd(o[1], o[2]);
+  for (; k + 6 <= n_values; k += 6)
+  {
+    __m128d v0 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(q + k)));
+    __m128d v1 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(q + k + 2)));
+    __m128d v2 = _mm_cvtepi32_pd(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(q + k + 4)));
+    __m128 f01 = _mm_movelh_ps(_mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(v0, s0), o0)), _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(v1, s1), o1)));
+    _mm_storeu_ps(out + k, f01);
+    _mm_storel_pi(reinterpret_cast<__m64 *>(out + k + 4), _mm_cvtpd_ps(_mm_add_pd(_mm_mul_pd(v2, s2), o2)));
+  }
+#endif
+  for (; k < n_values; ++k)
+  {
+    out[k] = float(q[k] * s[k % 3] + o[k % 3]);
+  }
+}
+PointCollection QuantizedPointCollection::to_point_collection(const arr3d &origin) const
+{
+  PointCollection result;
+  result.resize(size());
+  if (!empty())
+    decode(result.data(), 0, size(), origin);
+  result.get_attributes() = get_attributes();
+  return result;
+}
+
+bool QuantizedPointCollection::bounds(arr3i &qmin, arr3i &qmax) const
+{
+  if (points_.empty())
+    return false;
+  // plain integer min/max, which compilers vectorise
+  int32_t lo[3] = {points_[0][0], points_[0][1], points_[0][2]};
+  int32_t hi[3] = {lo[0], lo[1], lo[2]};
+  for (auto &q : points_)
+  {
+    for (size_t c = 0; c < 3; ++c)
+    {
+      lo[c] = q[c] < lo[c] ? q[c] : lo[c];
+      hi[c] = q[c] > hi[c] ? q[c] : hi[c];
+    }
+  }
+  qmin = {lo[0], lo[1], lo[2]};
+  qmax = {hi[0], hi[1], hi[2]};
+  return true;
+}
+Box QuantizedPointCollection::box(const arr3d &origin) const
+{
+  Box result;
+  arr3i qmin, qmax;
+  if (bounds(qmin, qmax))
+  {
+    // a negative scale swaps the bounds
+    for (auto &q : {qmin, qmax})
+    {
+      result.add(arr3d{offset_[0] + scale_[0] * q[0] - origin[0],
+                       offset_[1] + scale_[1] * q[1] - origin[1],
+                       offset_[2] + scale_[2] * q[2] - origin[2]});
+    }
+  }
+  return result;
+}
+vec1ui QuantizedPointCollection::grid_cells(double min_x, double min_y, double cellsize, size_t dim_x, size_t dim_y) const
+{
+  // cell coordinate = q * a + b, so one multiply-add per axis
+  const double ax = scale_[0] / cellsize, bx = (offset_[0] - min_x) / cellsize;
+  const double ay = scale_[1] / cellsize, by = (offset_[1] - min_y) / cellsize;
+  const size_t outside = dim_x * dim_y;
+  vec1ui result(points_.size());
+  for (size_t i = 0; i < points_.size(); ++i)
+  {
+    double cx = std::floor(points_[i][0] * ax + bx);
+    double cy = std::floor(points_[i][1] * ay + by);
+    bool inside = cx >= 0 && cy >= 0 && cx < double(dim_x) && cy < double(dim_y);
+    result[i] = inside ? size_t(cy) * dim_x + size_t(cx) : outside;
+  }
+  return result;
+}
+
 attribute_vec_map& AttributeVecMap::get_attributes()
 {
   return attribs_;
@@ -371,12 +549,9 @@ void TriangleCollection::compute_box()
   if (!bbox.has_value())
   {
     bbox = Box();
-    for (auto &t : *this)
-    {
-      bbox->add(t[0]);
-      bbox->add(t[1]);
-      bbox->add(t[2]);
-    }
+    // the triangles are stored contiguously, 3 vertices each
+    if (!empty())
+      bbox->add((*this)[0][0].data(), 3 * size());
   }
 }
 float *TriangleCollection::get_data_ptr()
@@ -384,6 +559,152 @@ float *TriangleCollection::get_data_ptr()
   return (*this)[0][0].data();
 }
 
+// grid cell of a coordinate for vertex welding, with tolerance 0 the bit pattern of the coordinate is used
+static int64_t weld_cell(float v, float tolerance)
+{
+  if (tolerance > 0)
+    return int64_t(std::floor(v / tolerance));
+  // -0 and 0 are the same vertex
+  v += 0.f;
+  uint32_t bits;
+  std::memcpy(&bits, &v, sizeof(bits));
+  return bits;
+}
+static uint64_t weld_hash(int64_t x, int64_t y, int64_t z)
+{
+  uint64_t h = uint64_t(x) * 0x9E3779B97F4A7C15ull;
+  h ^= uint64_t(y) * 0xC2B2AE3D27D4EB4Full + (h << 6) + (h >> 2);
+  h ^= uint64_t(z) * 0x165667B19E3779F9ull + (h << 6) + (h >> 2);
+  return h;
+}
+
+IndexedMesh IndexedMesh::from_triangles(const TriangleCollection &triangles, float tolerance)
+{
+  IndexedMesh mesh;
+  // a closed mesh has about half as many vertices as faces
+  mesh.reserve(triangles.size() / 2, triangles.size());
+
+  // the vertices in a cell form a chain that starts at cell_heads, hash collisions between cells end up in the same
+  // chain but are filtered out by the distance check
+  const uint32_t none = std::numeric_limits<uint32_t>::max();
+  std::unordered_map<uint64_t, uint32_t> cell_heads;
+  cell_heads.reserve(triangles.size());
+  std::vector<uint32_t> next_in_cell;
+  next_in_cell.reserve(triangles.size() / 2);
+  const int64_t reach = tolerance > 0 ? 1 : 0;
+
+  auto matches = [&](const arr3f &a, const arr3f &b) {
+    if (tolerance > 0)
+      return std::abs(a[0] - b[0]) <= tolerance && std::abs(a[1] - b[1]) <= tolerance && std::abs(a[2] - b[2]) <= tolerance;
+    return a == b;
+  };
+
+  for (auto &t : triangles)
+  {
+    uint32_t face[3];
+    for (size_t k = 0; k < 3; ++k)
+    {
+      auto &p = t[k];
+      int64_t cx = weld_cell(p[0], tolerance), cy = weld_cell(p[1], tolerance), cz = weld_cell(p[2], tolerance);
+      uint32_t found = none;
+      for (int64_t dx = -reach; dx <= reach && found == none; ++dx)
+        for (int64_t dy = -reach; dy <= reach && found == none; ++dy)
+          for (int64_t dz = -reach; dz <= reach && found == none; ++dz)
+          {
+            auto it = cell_heads.find(weld_hash(cx + dx, cy + dy, cz + dz));
+            if (it == cell_heads.end())
+              continue;
+            for (uint32_t v = it->second; v != none; v = next_in_cell[v])
+            {
+              if (matches(mesh.vertices_[v], p))
+              {
+                found = v;
+                break;
+              }
+            }
+          }
+      if (found == none)
+      {
+        found = mesh.add_vertex(p);
+        auto [it, inserted] = cell_heads.emplace(weld_hash(cx, cy, cz), found);
+        next_in_cell.push_back(inserted ? none : it->second);
+        it->second = found;
+      }
+      face[k] = found;
+    }
+    mesh.add_face(face[0], face[1], face[2]);
+  }
+  return mesh;
+}
+void IndexedMesh::compute_box()
+{
+  if (!bbox.has_value())
+  {
+    bbox = Box();
+    bbox->add(vertices_);
+  }
+}
+size_t IndexedMesh::vertex_count() const
+{
+  return vertices_.size();
+}
+size_t IndexedMesh::face_count() const
+{
+  return indices_.size() / 3;
+}
+float *IndexedMesh::get_data_ptr()
+{
+  return vertices_[0].data();
+}
+uint32_t IndexedMesh::add_vertex(const arr3f &vertex)
+{
+  vertices_.push_back(vertex);
+  bbox.reset();
+  return uint32_t(vertices_.size() - 1);
+}
+void IndexedMesh::add_face(uint32_t a, uint32_t b, uint32_t c)
+{
+  indices_.push_back(a);
+  indices_.push_back(b);
+  indices_.push_back(c);
+}
+void IndexedMesh::reserve(size_t vertices, size_t faces)
+{
+  vertices_.reserve(vertices);
+  indices_.reserve(3 * faces);
+}
+vec3f &IndexedMesh::vertices()
+{
+  bbox.reset();
+  return vertices_;
+}
+const vec3f &IndexedMesh::vertices() const
+{
+  return vertices_;
+}
+std::vector<uint32_t> &IndexedMesh::indices()
+{
+  return indices_;
+}
+const std::vector<uint32_t> &IndexedMesh::indices() const
+{
+  return indices_;
+}
+Triangle IndexedMesh::triangle(size_t face) const
+{
+  return {vertices_[indices_[3 * face]], vertices_[indices_[3 * face + 1]], vertices_[indices_[3 * face + 2]]};
+}
+TriangleCollection IndexedMesh::to_triangle_collection() const
+{
+  TriangleCollection result;
+  result.reserve(face_count());
+  for (size_t f = 0; f < face_count(); ++f)
+  {
+    result.push_back(triangle(f));
+  }
+  return result;
+}
+
 size_t SegmentCollection::vertex_count() const
 {
   return size() * 2;
@@ -393,11 +714,8 @@ void SegmentCollection::compute_box()
   if (!bbox.has_value())
   {
     bbox = Box();
-    for (auto &t : *this)
-    {
-      bbox->add(t[0]);
-      bbox->add(t[1]);
-    }
+    if (!empty())
+      bbox->add((*this)[0][0].data(), 2 * size());
   }
 }
 float *SegmentCollection::get_data_ptr()
@@ -455,6 +773,234 @@ float *LinearRingCollection::get_data_ptr()
   return (*this)[0][0].data();
 }
 
+VertexSpan::VertexSpan(const arr3f *data, size_t size) : data_(data), size_(size) {}
+const arr3f *VertexSpan::data() const
+{
+  return data_;
+}
+size_t VertexSpan::size() const
+{
+  return size_;
+}
+bool VertexSpan::empty() const
+{
+  return size_ == 0;
+}
+const arr3f &VertexSpan::operator[](size_t i) const
+{
+  return data_[i];
+}
+const arr3f *VertexSpan::begin() const
+{
+  return data_;
+}
+const arr3f *VertexSpan::end() const
+{
+  return data_ + size_;
+}
+vec3f VertexSpan::to_vec3f() const
+{
+  return vec3f(begin(), end());
+}
+
+void FlatGeometryCollection::compute_box()
+{
+  if (!bbox.has_value())
+  {
+    bbox = Box();
+    bbox->add(coordinates_);
+  }
+}
+void FlatGeometryCollection::push_ring(const vec3f &ring)
+{
+  coordinates_.insert(coordinates_.end(), ring.begin(), ring.end());
+  ring_offsets_.push_back(coordinates_.size());
+  bbox.reset();
+}
+void FlatGeometryCollection::close_geometry()
+{
+  geometry_offsets_.push_back(ring_offsets_.size() - 1);
+}
+size_t FlatGeometryCollection::size() const
+{
+  return geometry_offsets_.size() - 1;
+}
+bool FlatGeometryCollection::empty() const
+{
+  return size() == 0;
+}
+size_t FlatGeometryCollection::ring_count() const
+{
+  return ring_offsets_.size() - 1;
+}
+size_t FlatGeometryCollection::ring_count(size_t geometry) const
+{
+  return geometry_offsets_[geometry + 1] - geometry_offsets_[geometry];
+}
+size_t FlatGeometryCollection::vertex_count() const
+{
+  return coordinates_.size();
+}
+float *FlatGeometryCollection::get_data_ptr()
+{
+  return coordinates_[0].data();
+}
+void FlatGeometryCollection::reserve(size_t geometries, size_t rings, size_t vertices)
+{
+  geometry_offsets_.reserve(geometries + 1);
+  ring_offsets_.reserve(rings + 1);
+  coordinates_.reserve(vertices);
+}
+void FlatGeometryCollection::clear()
+{
+  coordinates_.clear();
+  ring_offsets_.assign(1, 0);
+  geometry_offsets_.assign(1, 0);
+  bbox.reset();
+}
+VertexSpan FlatGeometryCollection::ring(size_t r) const
+{
+  return VertexSpan(coordinates_.data() + ring_offsets_[r], ring_offsets_[r + 1] - ring_offsets_[r]);
+}
+VertexSpan FlatGeometryCollection::ring(size_t geometry, size_t r) const
+{
+  return ring(geometry_offsets_[geometry] + r);
+}
+vec3f &FlatGeometryCollection::coordinates()
+{
+  bbox.reset();
+  return coordinates_;
+}
+const vec3f &FlatGeometryCollection::coordinates() const
+{
+  return coordinates_;
+}
+const vec1ui &FlatGeometryCollection::ring_offsets() const
+{
+  return ring_offsets_;
+}
+const vec1ui &FlatGeometryCollection::geometry_offsets() const
+{
+  return geometry_offsets_;
+}
+
+FlatLineStringCollection::FlatLineStringCollection(const LineStringCollection &linestrings)
+{
+  reserve(linestrings.size(), linestrings.size(), linestrings.vertex_count());
+  for (auto &linestring : linestrings)
+  {
+    push_back(linestring);
+  }
+}
+void FlatLineStringCollection::push_back(const vec3f &linestring)
+{
+  push_ring(linestring);
+  close_geometry();
+}
+VertexSpan FlatLineStringCollection::operator[](size_t i) const
+{
+  return ring(i);
+}
+LineStringCollection FlatLineStringCollection::to_linestring_collection() const
+{
+  LineStringCollection result;
+  result.reserve(size());
+  for (size_t i = 0; i < size(); ++i)
+  {
+    result.push_back(ring(i).to_vec3f());
+  }
+  return result;
+}
+
+FlatPolygonCollection::FlatPolygonCollection(const LinearRingCollection &rings)
+{
+  reserve(rings.size(), rings.size(), rings.vertex_count());
+  for (auto &ring : rings)
+  {
+    push_back(ring);
+  }
+}
+FlatPolygonCollection::FlatPolygonCollection(const std::vector<LinearRing> &polygons)
+{
+  size_t n_rings = 0, n_vertices = 0;
+  for (auto &polygon : polygons)
+  {
+    n_rings += 1 + polygon.interior_rings().size();
+    n_vertices += polygon.size();
+    for (auto &iring : polygon.interior_rings())
+      n_vertices += iring.size();
+  }
+  reserve(polygons.size(), n_rings, n_vertices);
+  for (auto &polygon : polygons)
+  {
+    push_back(polygon);
+  }
+}
+void FlatPolygonCollection::push_back(const vec3f &exterior_ring)
+{
+  push_ring(exterior_ring);
+  close_geometry();
+}
+void FlatPolygonCollection::push_back(const LinearRing &polygon)
+{
+  push_ring(polygon);
+  for (auto &iring : polygon.interior_rings())
+  {
+    push_ring(iring);
+  }
+  close_geometry();
+}
+void FlatPolygonCollection::push_interior_ring(const vec3f &ring)
+{
+  if (empty())
+    throw std::logic_error("can not add an interior ring to an empty polygon collection");
+  push_ring(ring);
+  geometry_offsets_.back() = ring_offsets_.size() - 1;
+}
+VertexSpan FlatPolygonCollection::exterior_ring(size_t i) const
+{
+  return ring(i, 0);
+}
+size_t FlatPolygonCollection::interior_ring_count(size_t i) const
+{
+  return ring_count(i) - 1;
+}
+VertexSpan FlatPolygonCollection::interior_ring(size_t i, size_t j) const
+{
+  return ring(i, j + 1);
+}
+LinearRing FlatPolygonCollection::linear_ring(size_t i) const
+{
+  LinearRing result;
+  auto exterior = exterior_ring(i);
+  result.assign(exterior.begin(), exterior.end());
+  for (size_t j = 0; j < interior_ring_count(i); ++j)
+  {
+    result.interior_rings().push_back(interior_ring(i, j).to_vec3f());
+  }
+  return result;
+}
+LinearRingCollection FlatPolygonCollection::to_linearring_collection() const
+{
+  LinearRingCollection result;
+  result.reserve(size());
+  for (size_t i = 0; i < size(); ++i)
+  {
+    result.push_back(exterior_ring(i).to_vec3f());
+  }
+  return result;
+}
+std::vector<LinearRing> FlatPolygonCollection::to_linear_rings() const
+{
+  std::vector<LinearRing> result;
+  result.reserve(size());
+  for (size_t i = 0; i < size(); ++i)
+  {
+    result.push_back(linear_ring(i));
+  }
+  return result;
+}
+
 void Mesh::push_polygon(LinearRing& polygon, int label) {
   polygons_.push_back(polygon);
   labels_.push_back(label);
@@ -482,13 +1028,218 @@ const std::vector<int>& Mesh::get_labels() const {
 //   return attributes_;
 // };
 
+size_t AttributeTable::Column::row_size(size_t row) const
+{
+  return offsets[row + 1] - offsets[row];
+}
+attribute_value AttributeTable::Column::value(size_t i) const
+{
+  return std::visit([i](auto &vec) { return attribute_value(vec[i]); }, values);
+}
+std::vector<attribute_value> AttributeTable::Column::row(size_t row) const
+{
+  std::vector<attribute_value> result;
+  result.reserve(row_size(row));
+  for (size_t i = offsets[row]; i < offsets[row + 1]; ++i)
+    result.push_back(value(i));
+  return result;
+}
+
+AttributeTable::Row::Row(const AttributeTable &table, size_t row) : table_(&table), row_(row) {}
+bool AttributeTable::Row::has(const std::string &name) const
+{
+  return table_->has_column(name) && table_->column(name).row_size(row_) > 0;
+}
+size_t AttributeTable::Row::size(const std::string &name) const
+{
+  return table_->column(name).row_size(row_);
+}
+attribute_value AttributeTable::Row::value(const std::string &name, size_t i) const
+{
+  auto &column = table_->column(name);
+  if (i >= column.row_size(row_))
+    throw std::out_of_range("attribute " + name + " has no value " + std::to_string(i) + " in row " + std::to_string(row_));
+  return column.value(column.offsets[row_] + i);
+}
+std::vector<attribute_value> AttributeTable::Row::at(const std::string &name) const
+{
+  return table_->column(name).row(row_);
+}
+AttributeMap AttributeTable::Row::to_map() const
+{
+  AttributeMap result;
+  for (size_t c = 0; c < table_->names_.size(); ++c)
+  {
+    auto &column = table_->columns_[c];
+    if (column.row_size(row_) > 0)
+      result.emplace(table_->names_[c], column.row(row_));
+  }
+  return result;
+}
+
+size_t AttributeTable::size() const
+{
+  return n_rows_;
+}
+bool AttributeTable::empty() const
+{
+  return n_rows_ == 0;
+}
+void AttributeTable::clear()
+{
+  n_rows_ = 0;
+  names_.clear();
+  columns_.clear();
+  column_index_.clear();
+}
+const std::vector<std::string> &AttributeTable::names() const
+{
+  return names_;
+}
+bool AttributeTable::has_column(const std::string &name) const
+{
+  return column_index_.count(name) > 0;
+}
+const AttributeTable::Column &AttributeTable::column(const std::string &name) const
+{
+  return columns_[column_index_.at(name)];
+}
+
+// append a value to column values of the same type
+struct AppendValue
+{
+  AttributeTable::column_values &values;
+  template <typename T> void operator()(const T &value)
+  {
+    std::get<std::vector<T>>(values).push_back(value);
+  }
+};
+
+void AttributeTable::push_back(const AttributeMap &attributes)
+{
+  // check the types first so that a bad row leaves the table untouched, the alternatives of attribute_value and
+  // column_values are in the same order
+  for (auto &[name, values] : attributes)
+  {
+    if (values.empty())
+      continue;
+    size_t type = has_column(name) ? column(name).values.index() : values[0].index();
+    for (auto &value : values)
+    {
+      if (value.index() != type)
+        throw std::invalid_argument("values of attribute " + name + " do not all have the type of its column");
+    }
+  }
+  for (auto &[name, values] : attributes)
+  {
+    if (values.empty() || has_column(name))
+      continue;
+    // the type of the new column follows from its first value
+    Column column;
+    std::visit([&column](auto &v) { column.values = std::vector<std::decay_t<decltype(v)>>(); }, values[0]);
+    column.offsets.assign(n_rows_ + 1, 0);
+    column_index_[name] = columns_.size();
+    names_.push_back(name);
+    columns_.push_back(std::move(column));
+  }
+  for (size_t c = 0; c < columns_.size(); ++c)
+  {
+    auto &column = columns_[c];
+    auto it = attributes.find(names_[c]);
+    if (it != attributes.end())
+    {
+      for (auto &value : it->second)
+        std::visit(AppendValue{column.values}, value);
+    }
+    column.offsets.push_back(std::visit([](auto &vec) { return vec.size(); }, column.values));
+  }
+  ++n_rows_;
+}
+void AttributeTable::set_column(const std::string &name, Column column)
+{
+  if (names_.empty() && n_rows_ == 0)
+    n_rows_ = column.offsets.size() - 1;
+  if (column.offsets.size() != n_rows_ + 1)
+    throw std::invalid_argument("column " + name + " does not have the same number of rows as the attribute table");
+  auto it = column_index_.find(name);
+  if (it != column_index_.end())
+  {
+    columns_[it->second] = std::move(column);
+    return;
+  }
+  column_index_[name] = columns_.size();
+  names_.push_back(name);
+  columns_.push_back(std::move(column));
+}
+void AttributeTable::set(const std::string &name, size_t row, size_t i, const attribute_value &value)
+{
+  auto &column = columns_[column_index_.at(name)];
+  if (row >= n_rows_ || i >= column.row_size(row))
+    throw std::out_of_range("attribute " + name + " has no value " + std::to_string(i) + " in row " + std::to_string(row));
+  if (value.index() != column.values.index())
+    throw std::invalid_argument("value for attribute " + name + " does not have the type of its column");
+  // the alternatives of attribute_value and column_values are in the same order
+  size_t offset = column.offsets[row] + i;
+  std::visit([&column, offset](auto &v) {
+    std::get<std::vector<std::decay_t<decltype(v)>>>(column.values)[offset] = v;
+  }, value);
+}
+void AttributeTable::set_row(const std::string &name, size_t row, const std::vector<attribute_value> &values)
+{
+  if (row >= n_rows_)
+    throw std::out_of_range("attribute table row " + std::to_string(row) + " is out of range");
+  auto it = column_index_.find(name);
+  if (it == column_index_.end() && values.empty())
+    return;
+  size_t type = it != column_index_.end() ? columns_[it->second].values.index() : values[0].index();
+  for (auto &value : values)
+  {
+    if (value.index() != type)
+      throw std::invalid_argument("values of attribute " + name + " do not all have the type of its column");
+  }
+  if (it == column_index_.end())
+  {
+    Column column;
+    std::visit([&column](auto &v) { column.values = std::vector<std::decay_t<decltype(v)>>(); }, values[0]);
+    column.offsets.assign(n_rows_ + 1, 0);
+    it = column_index_.emplace(name, columns_.size()).first;
+    names_.push_back(name);
+    columns_.push_back(std::move(column));
+  }
+  auto &column = columns_[it->second];
+  size_t old_size = column.row_size(row);
+  std::visit([&](auto &vec) {
+    typedef typename std::decay_t<decltype(vec)>::value_type T;
+    auto first = vec.begin() + column.offsets[row];
+    first = vec.erase(first, vec.begin() + column.offsets[row + 1]);
+    std::vector<T> row_values;
+    row_values.reserve(values.size());
+    for (auto &value : values)
+      row_values.push_back(std::get<T>(value));
+    vec.insert(first, row_values.begin(), row_values.end());
+  }, column.values);
+  // shift the offsets of the following rows by the change in the number of values of this row
+  for (size_t r = row + 1; r <= n_rows_; ++r)
+    column.offsets[r] = column.offsets[r] - old_size + values.size();
+}
+AttributeTable::Row AttributeTable::operator[](size_t row) const
+{
+  return Row(*this, row);
+}
+AttributeTable::Row AttributeTable::at(size_t row) const
+{
+  if (row >= n_rows_)
+    throw std::out_of_range("attribute table row " + std::to_string(row) + " is out of range");
+  return Row(*this, row);
+}
+
 void MultiTriangleCollection::push_back(
   TriangleCollection& trianglecollection)
 {
   trianglecollections_.push_back(trianglecollection);
 }
 void MultiTriangleCollection::push_back(
-  AttributeMap& attributemap)
+  const AttributeMap& attributemap)
 {
   attributes_.push_back(attributemap);
 }
@@ -520,11 +1271,11 @@ const std::vector<TriangleCollection>& MultiTriangleCollection::get_tricollectio
   return trianglecollections_;
 }
 
-std::vector<AttributeMap>& MultiTriangleCollection::get_attributes()
+AttributeTable& MultiTriangleCollection::get_attributes()
 {
   return attributes_;
 }
-const std::vector<AttributeMap>& MultiTriangleCollection::get_attributes() const
+const AttributeTable& MultiTriangleCollection::get_attributes() const
 {
   return attributes_;
 }
@@ -538,13 +1289,35 @@ const TriangleCollection& MultiTriangleCollection::tri_at(size_t i) const
   return trianglecollections_.at(i);
 }
 
-AttributeMap& MultiTriangleCollection::attr_at(size_t i)
+AttributeTable::Row MultiTriangleCollection::attr_at(size_t i) const
 {
   return attributes_.at(i);
 }
-const AttributeMap& MultiTriangleCollection::attr_at(size_t i) const
+void MultiTriangleCollection::set_attribute(size_t i, const std::string& name, const std::vector<attribute_value>& values)
 {
-  return attributes_.at(i);
+  attributes_.set_row(name, i, values);
+}
+
+const std::vector<std::type_index>& geometry_types()
+{
+  static const std::vector<std::type_index> types = GeometryTypes::type_indices();
+  return types;
+}
+const std::vector<std::string>& geometry_type_names()
+{
+  static const std::vector<std::string> names = {"LinearRing", "LineString", "PointCollection",
+    "TriangleCollection", "SegmentCollection", "LineStringCollection", "LinearRingCollection",
+    "MultiTriangleCollection", "Mesh", "IndexedMesh"};
+  if (names.size() != GeometryTypes::size)
+    throw std::logic_error("geometry_type_names() does not match GeometryTypes");
+  return names;
+}
+std::optional<size_t> geometry_type_index(std::type_index type)
+{
+  auto& types = geometry_types();
+  auto it = std::find(types.begin(), types.end(), type);
+  if (it == types.end()) return std::nullopt;
+  return size_t(it - types.begin());
 }
 
 std::vector<std::string> split_string(const std::string& s, std::string delimiter) {
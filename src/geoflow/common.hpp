@@ -17,6 +17,7 @@
 #pragma once
 
 #include <array>
+#include <cstdint>
 #include <vector>
 #include <optional>
 #include <unordered_map>
@@ -107,12 +108,17 @@ public:
   void add(Box &otherBox);
   void add(const vec3f &vec);
   void add(vec3f &vec);
+  // add n points stored as consecutive x,y,z floats
+  void add(const float *xyz, size_t n);
   bool intersects(Box &otherBox) const;
   void clear();
   bool isEmpty() const;
   arr3f center() const;
 };
 
+// The box is computed on the first call to box() and cached. Members that add or remove vertices reset it, but
+// writes to existing vertices (through operator[], iterators or a held reference) do not: call invalidate_box()
+// after modifying the vertices in place.
 class Geometry
 {
 protected:
@@ -122,16 +128,56 @@ protected:
 public:
   virtual size_t vertex_count() const = 0;
   virtual const Box &box();
+  // to be called after the vertices are modified in place
+  void invalidate_box();
   size_t dimension();
   virtual float *get_data_ptr() = 0;
 };
 
+// std::vector for the vertices (or parts) of geometry type G, its size changing members reset the cached box of G
+template <typename G, typename T>
+class GeometryVector : public std::vector<T>
+{
+  void invalidate() { static_cast<G *>(this)->invalidate_box(); }
+
+public:
+  void push_back(const T &value) { invalidate(); std::vector<T>::push_back(value); }
+  void push_back(T &&value) { invalidate(); std::vector<T>::push_back(std::move(value)); }
+  template <typename... Args> T &emplace_back(Args &&...args)
+  {
+    invalidate();
+    return std::vector<T>::emplace_back(std::forward<Args>(args)...);
+  }
+  template <typename... Args> auto insert(Args &&...args)
+  {
+    invalidate();
+    return std::vector<T>::insert(std::forward<Args>(args)...);
+  }
+  template <typename... Args> auto erase(Args &&...args)
+  {
+    invalidate();
+    return std::vector<T>::erase(std::forward<Args>(args)...);
+  }
+  template <typename... Args> void assign(Args &&...args)
+  {
+    invalidate();
+    std::vector<T>::assign(std::forward<Args>(args)...);
+  }
+  template <typename... Args> void resize(Args &&...args)
+  {
+    invalidate();
+    std::vector<T>::resize(std::forward<Args>(args)...);
+  }
+  void pop_back() { invalidate(); std::vector<T>::pop_back(); }
+  void clear() { invalidate(); std::vector<T>::clear(); }
+};
+
 // geometry types:
 // typedef arr3f Point;
 typedef std::array<arr3f, 3> Triangle;
 // typedef std::array<arr3f, 2> Segment;
 
-class LinearRing : public vec3f, public Geometry
+class LinearRing : public GeometryVector<LinearRing, arr3f>, public Geometry
 {
   std::vector<vec3f> interior_rings_;
 protected:
@@ -163,7 +209,7 @@ public:
   // std::vector<vec3f> interior_rings_;
 // };
 
-class LineString : public vec3f, public Geometry
+class LineString : public GeometryVector<LineString, arr3f>, public Geometry
 {
 protected:
   void compute_box();
@@ -173,7 +219,7 @@ public:
   float *get_data_ptr();
 };
 template <typename geom_def>
-class GeometryCollection : public Geometry, public std::vector<geom_def>
+class GeometryCollection : public Geometry, public GeometryVector<GeometryCollection<geom_def>, geom_def>
 {
 };
 
@@ -185,35 +231,170 @@ public:
   float *get_data_ptr();
 };
 
+// Attributes of the elements of a collection, stored per attribute name in one typed column. Row i of a column is
+// values[offsets[i]] to values[offsets[i+1]], so it can hold a single value (per element attribute), a value per
+// face (per face attribute) or nothing (no value for that element).
+class AttributeTable
+{
+public:
+  typedef std::variant<vec1b, vec1i, vec1s, vec1f> column_values;
+
+  // Typed view on the values of one row of a column, it points into the column and is invalidated when the column
+  // changes. Iterators instead of pointers because vec1b has no contiguous bool storage.
+  template <typename T> class RowValues
+  {
+    typename std::vector<T>::const_iterator begin_, end_;
+
+  public:
+    RowValues(typename std::vector<T>::const_iterator begin, typename std::vector<T>::const_iterator end)
+        : begin_(begin), end_(end) {}
+    size_t size() const { return end_ - begin_; }
+    bool empty() const { return begin_ == end_; }
+    typename std::vector<T>::const_reference operator[](size_t i) const { return begin_[i]; }
+    typename std::vector<T>::const_iterator begin() const { return begin_; }
+    typename std::vector<T>::const_iterator end() const { return end_; }
+  };
+
+  struct Column
+  {
+    column_values values;
+    vec1ui offsets = {0};
+
+    size_t row_size(size_t row) const;
+    attribute_value value(size_t i) const;
+    // copy of the values of a row
+    std::vector<attribute_value> row(size_t row) const;
+    // values of a row without copying, throws std::bad_variant_access when T is not the type of the column
+    template <typename T> RowValues<T> row_values(size_t row) const
+    {
+      auto &vec = std::get<std::vector<T>>(values);
+      return RowValues<T>(vec.begin() + offsets[row], vec.begin() + offsets[row + 1]);
+    }
+  };
+
+  // Read-only view on one row of the table, it only holds a pointer to the table and the row index
+  class Row
+  {
+    const AttributeTable *table_;
+    size_t row_;
+
+  public:
+    Row(const AttributeTable &table, size_t row);
+    bool has(const std::string &name) const;
+    // the rest throw std::out_of_range for unknown names
+    // number of values of this row for attribute name
+    size_t size(const std::string &name) const;
+    // value i of this row for attribute name
+    attribute_value value(const std::string &name, size_t i = 0) const;
+    // typed values of this row for attribute name, see Column::row_values
+    template <typename T> RowValues<T> values(const std::string &name) const
+    {
+      return table_->column(name).row_values<T>(row_);
+    }
+    // copy of the values of this row for attribute name
+    std::vector<attribute_value> at(const std::string &name) const;
+    AttributeMap to_map() const;
+  };
+
+private:
+  size_t n_rows_ = 0;
+  std::vector<std::string> names_;
+  std::vector<Column> columns_;
+  std::unordered_map<std::string, size_t> column_index_;
+
+public:
+  size_t size() const;
+  bool empty() const;
+  void clear();
+  const std::vector<std::string> &names() const;
+  bool has_column(const std::string &name) const;
+  // throws std::out_of_range for unknown names
+  const Column &column(const std::string &name) const;
+
+  // Append a row. Unknown names add a column that is empty for the earlier rows, the values of known names must
+  // have the type of their column (std::invalid_argument otherwise).
+  void push_back(const AttributeMap &attributes);
+  // Add or replace a whole column, its offsets must cover the rows of the table. Sets the number of rows of an
+  // empty table.
+  void set_column(const std::string &name, Column column);
+  // Set value i of a row in place, it must have the type of the column (std::invalid_argument otherwise) and i must
+  // be smaller than the number of values of the row (std::out_of_range otherwise).
+  void set(const std::string &name, size_t row, size_t i, const attribute_value &value);
+  // Replace all values of a row, their number may differ from the current row. Unknown names add a column that is
+  // empty for the other rows, values must have the type of the column (std::invalid_argument otherwise).
+  void set_row(const std::string &name, size_t row, const std::vector<attribute_value> &values);
+
+  Row operator[](size_t row) const;
+  Row at(size_t row) const;
+};
+
 // MultiTriangleCollection stores a collection of TriangleCollections along with
-// attributes for each TriangleCollection. The vector of TriangleCollections
-// `trianglecollections_` and the vector of AttributeMaps `attributes_`
+// attributes for each TriangleCollection. The TriangleCollections
+// `trianglecollections_` and the rows of the AttributeTable `attributes_` are
 // supposed to have the same length when attributes are present, however this is
 // not enforced. The `attributes_` can be empty.
 class MultiTriangleCollection
 {
   std::vector<TriangleCollection> trianglecollections_;
-  std::vector<AttributeMap>       attributes_;
+  AttributeTable                  attributes_;
 
 public:
   std::vector<int> building_part_ids_;
 
   void push_back(TriangleCollection & trianglecollection);
-  void push_back(AttributeMap & attributemap);
+  void push_back(const AttributeMap & attributemap);
   std::vector<TriangleCollection>& get_tricollections();
   const std::vector<TriangleCollection>& get_tricollections() const;
-  std::vector<AttributeMap>& get_attributes();
-  const std::vector<AttributeMap>& get_attributes() const;
+  AttributeTable& get_attributes();
+  const AttributeTable& get_attributes() const;
   TriangleCollection& tri_at(size_t i);
   const TriangleCollection& tri_at(size_t i) const;
-  AttributeMap& attr_at(size_t i);
-  const AttributeMap& attr_at(size_t i) const;
+  // read-only, edit the attributes of a TriangleCollection in place with set_attribute or get_attributes().set()
+  AttributeTable::Row attr_at(size_t i) const;
+  // replace the values of attribute name of TriangleCollection i, see AttributeTable::set_row
+  void set_attribute(size_t i, const std::string & name, const std::vector<attribute_value> & values);
   size_t tri_size() const;
   size_t attr_size() const;
   bool has_attributes();
   bool has_attributes() const;
 };
 
+// Triangle mesh with shared vertices, every face is three indices into the vertex buffer. The attributes are per
+// face columns.
+class IndexedMesh : public Geometry, public AttributeVecMap
+{
+  vec3f vertices_;
+  std::vector<uint32_t> indices_;
+
+protected:
+  void compute_box();
+
+public:
+  // Weld the corners of the triangles into shared vertices. A corner within tolerance (in each coordinate) of an
+  // earlier vertex reuses that vertex, with tolerance 0 only identical corners are merged. Face i is triangle i, also
+  // when it collapsed because of the welding.
+  static IndexedMesh from_triangles(const TriangleCollection &triangles, float tolerance = 0);
+
+  size_t vertex_count() const;
+  size_t face_count() const;
+  // pointer to the vertex buffer
+  float *get_data_ptr();
+
+  uint32_t add_vertex(const arr3f &vertex);
+  void add_face(uint32_t a, uint32_t b, uint32_t c);
+  void reserve(size_t vertices, size_t faces);
+
+  // the cached box is reset on non-const access to the vertices, call invalidate_box() after editing them through a
+  // reference that was held across a call to box()
+  vec3f &vertices();
+  const vec3f &vertices() const;
+  std::vector<uint32_t> &indices();
+  const std::vector<uint32_t> &indices() const;
+
+  Triangle triangle(size_t face) const;
+  TriangleCollection to_triangle_collection() const;
+};
+
 class SegmentCollection : public GeometryCollection<std::array<arr3f, 2>>, public AttributeVecMap
 {
 public:
@@ -230,6 +411,51 @@ public:
   float *get_data_ptr();
 };
 
+typedef std::array<int32_t, 3> arr3i;
+
+// Points stored like in LAS: as int32 triplets with a per collection scale and offset, point i is at
+// offset + scale * q[i]. Precision is the same over the whole extent, unlike float coordinates that are relative to
+// a data offset. The kernels below work on the quantised values directly, decode() converts to float on demand.
+class QuantizedPointCollection : public AttributeVecMap
+{
+  std::vector<arr3i> points_;
+  arr3d scale_;
+  arr3d offset_;
+
+public:
+  QuantizedPointCollection(arr3d scale = {0.001, 0.001, 0.001}, arr3d offset = {0, 0, 0});
+  // quantise float points that are relative to origin (eg. the data offset of the process CRS), the attributes are
+  // copied. Throws std::out_of_range if a point does not fit in int32 with this scale and offset.
+  static QuantizedPointCollection quantize(const PointCollection &points, arr3d scale, arr3d offset, const arr3d &origin = {0, 0, 0});
+
+  size_t size() const;
+  bool empty() const;
+  void reserve(size_t n);
+  void clear();
+  const arr3d &scale() const;
+  const arr3d &offset() const;
+  std::vector<arr3i> &quantized();
+  const std::vector<arr3i> &quantized() const;
+
+  void push_back(const arr3i &q);
+  // rounds to the nearest quantised position, throws std::out_of_range if that does not fit in int32
+  void push_back(const arr3d &p);
+  arr3d coordinate(size_t i) const;
+
+  // float coordinates of points [begin, begin+n) relative to origin
+  void decode(arr3f *result, size_t begin, size_t n, const arr3d &origin = {0, 0, 0}) const;
+  // all points as float relative to origin, with the attributes
+  PointCollection to_point_collection(const arr3d &origin = {0, 0, 0}) const;
+
+  // quantised bounds, false if the collection is empty
+  bool bounds(arr3i &qmin, arr3i &qmax) const;
+  // box relative to origin
+  Box box(const arr3d &origin = {0, 0, 0}) const;
+  // row major index of the grid cell (of cellsize, with its minimum corner at min_x, min_y) of every point, points
+  // outside of the dim_x * dim_y cells get the index dim_x * dim_y
+  vec1ui grid_cells(double min_x, double min_y, double cellsize, size_t dim_x, size_t dim_y) const;
+};
+
 class LineStringCollection : public GeometryCollection<vec3f>
 {
 public:
@@ -246,6 +472,96 @@ public:
   float *get_data_ptr();
 };
 
+// Read-only view on a run of consecutive vertices in a coordinate buffer
+class VertexSpan
+{
+  const arr3f *data_;
+  size_t size_;
+
+public:
+  VertexSpan(const arr3f *data, size_t size);
+  const arr3f *data() const;
+  size_t size() const;
+  bool empty() const;
+  const arr3f &operator[](size_t i) const;
+  const arr3f *begin() const;
+  const arr3f *end() const;
+  vec3f to_vec3f() const;
+};
+
+// Flat (GeoArrow style) layout for collections of linestrings or polygons. The
+// vertices of all geometries are stored in one contiguous coordinate buffer,
+// ring_offsets_[r] to ring_offsets_[r+1] are the vertices of ring r and
+// geometry_offsets_[g] to geometry_offsets_[g+1] are the rings of geometry g.
+class FlatGeometryCollection : public Geometry
+{
+protected:
+  vec3f coordinates_;
+  vec1ui ring_offsets_ = {0};
+  vec1ui geometry_offsets_ = {0};
+
+  void compute_box();
+  // append a ring to the last geometry
+  void push_ring(const vec3f &ring);
+  void close_geometry();
+
+public:
+  // number of geometries
+  size_t size() const;
+  bool empty() const;
+  size_t ring_count() const;
+  size_t ring_count(size_t geometry) const;
+  size_t vertex_count() const;
+  // pointer to the coordinates of all geometries
+  float *get_data_ptr();
+  void reserve(size_t geometries, size_t rings, size_t vertices);
+  void clear();
+
+  VertexSpan ring(size_t r) const;
+  VertexSpan ring(size_t geometry, size_t r) const;
+
+  // the cached box is reset on non-const access to the coordinates, call invalidate_box() after editing them through
+  // a reference that was held across a call to box()
+  vec3f &coordinates();
+  const vec3f &coordinates() const;
+  const vec1ui &ring_offsets() const;
+  const vec1ui &geometry_offsets() const;
+};
+
+// Every geometry has exactly one ring
+class FlatLineStringCollection : public FlatGeometryCollection
+{
+public:
+  FlatLineStringCollection() = default;
+  explicit FlatLineStringCollection(const LineStringCollection &linestrings);
+
+  void push_back(const vec3f &linestring);
+  VertexSpan operator[](size_t i) const;
+  LineStringCollection to_linestring_collection() const;
+};
+
+// The first ring of each geometry is the exterior ring, any others are interior rings
+class FlatPolygonCollection : public FlatGeometryCollection
+{
+public:
+  FlatPolygonCollection() = default;
+  explicit FlatPolygonCollection(const LinearRingCollection &rings);
+  explicit FlatPolygonCollection(const std::vector<LinearRing> &polygons);
+
+  void push_back(const vec3f &exterior_ring);
+  void push_back(const LinearRing &polygon);
+  // add an interior ring to the last polygon, throws std::logic_error if there is none
+  void push_interior_ring(const vec3f &ring);
+
+  VertexSpan exterior_ring(size_t i) const;
+  size_t interior_ring_count(size_t i) const;
+  VertexSpan interior_ring(size_t i, size_t j) const;
+  LinearRing linear_ring(size_t i) const;
+  // exterior rings only, LinearRingCollection has no interior rings
+  LinearRingCollection to_linearring_collection() const;
+  std::vector<LinearRing> to_linear_rings() const;
+};
+
 
 // struct AttributeVec {
 //   AttributeVec(std::type_index ttype) : value_type(ttype) {};
@@ -277,6 +593,37 @@ class Mesh {
   // const std::unordered_map<std::string, AttributeVec>&  get_attributes() const;
 };
 
+// Geometry types that nodes pass around in std::any. The order is stored in flowcharts by parameters that select one
+// of them (eg. geometry_type), so new types go at the end. Code that handles every geometry type dispatches with
+// visit_geometry(), so that adding a type here is enough for it to be handled there (or fail to compile).
+template <typename... T> struct GeometryTypeList
+{
+  static constexpr size_t size = sizeof...(T);
+  // calls f(const G&) for the G that geometry holds, false if it holds none of these types
+  template <typename F> static bool visit(const std::any &geometry, F &f)
+  {
+    auto visit_one = [&f](auto *g) {
+      if (g) f(*g);
+      return g != nullptr;
+    };
+    return (visit_one(std::any_cast<T>(&geometry)) || ...);
+  }
+  static std::vector<std::type_index> type_indices() { return {typeid(T)...}; }
+};
+typedef GeometryTypeList<LinearRing, LineString, PointCollection, TriangleCollection, SegmentCollection,
+                         LineStringCollection, LinearRingCollection, MultiTriangleCollection, Mesh, IndexedMesh>
+    GeometryTypes;
+
+template <typename F> bool visit_geometry(const std::any &geometry, F &&f)
+{
+  return GeometryTypes::visit(geometry, f);
+}
+// types and names of GeometryTypes, in the same order
+const std::vector<std::type_index> &geometry_types();
+const std::vector<std::string> &geometry_type_names();
+// index of type in geometry_types()
+std::optional<size_t> geometry_type_index(std::type_index type);
+
 // modelled after https://gdal.org/api/ogrfeature_cpp.html#_CPPv4NK10OGRFeature18GetFieldAsDateTimeEiPiPiPiPiPiPiPi
 struct Date {
   int year;
@@ -14,14 +14,22 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "geoflow.hpp"
+#include "parallel.hpp"
+#include "selection.hpp"
+#include "spatial_index.hpp"
+#include "spatial_join.hpp"
+#include "geometry_measures.hpp"
 #ifdef GF_BUILD_WITH_GUI
   #include "imgui.h"
   #include "gui/parameter_widgets.hpp"
 #endif
 
+#include <atomic>
 #include <chrono>
 #include <ctime>
 #include <fstream>
+#include <numeric>
+#include <type_traits>
 // #include <taskflow/taskflow.hpp>
 
 namespace geoflow::nodes::core {
@@ -35,60 +43,65 @@ namespace geoflow::nodes::core {
 
   class IntNode : public Node {
     int value_=0;
+    OutputHandle<int> value_output_;
     public:
     using Node::Node;
     void init(){
-      add_output("value", typeid(int));
+      value_output_ = add_output<int>("value");
       add_param(ParamInt(value_, "value", "Integer value"));
     };
     void process(){
-      output("value").set(value_);
+      value_output_.set(value_);
     };
   };
   class FloatNode : public Node {
     float value_=0;
+    OutputHandle<float> value_output_;
     public:
     using Node::Node;
     void init(){
-      add_output("value", typeid(float));
+      value_output_ = add_output<float>("value");
       add_param(ParamFloat(value_, "value", "Floating point value"));
     };
     void process(){
-      output("value").set(value_);
+      value_output_.set(value_);
     };
   };
   class FloatExprNode : public Node {
     std::string expr_string_="";
+    OutputHandle<float> value_output_;
     public:
     using Node::Node;
     void init(){
-      add_output("value", typeid(float));
+      value_output_ = add_output<float>("value");
       add_param(ParamString(expr_string_, "value", "Expression string"));
     };
     void process();
   };
   class BoolNode : public Node {
     bool value_=true;
+    OutputHandle<bool> value_output_;
     public:
     using Node::Node;
     void init(){
-      add_output("value", typeid(bool));
+      value_output_ = add_output<bool>("value");
       add_param(ParamBool(value_, "value", "Boolean value"));
     };
     void process(){
-      output("value").set(value_);
+      value_output_.set(value_);
     };
   };
   class TextNode : public Node {
     std::string value_="";
+    OutputHandle<std::string> value_output_;
     public:
     using Node::Node;
     void init(){
-      add_output("value", typeid(std::string));
+      value_output_ = add_output<std::string>("value");
       add_param(ParamText(value_, "value", "Text value"));
     };
     void process(){
-      output("value").set( manager.substitute_globals(value_) );
+      value_output_.set( manager.substitute_globals(value_) );
     };
   };
 
@@ -161,14 +174,15 @@ namespace geoflow::nodes::core {
 
   class TextWriterNode : public Node {
     std::string filepath_="";
+    InputHandle<std::string> value_input_;
     public:
     using Node::Node;
     void init(){
-      add_input("value", typeid(std::string));
+      value_input_ = add_input<std::string>("value");
       add_param(ParamPath(filepath_, "filepath", "File path"));
     };
     void process(){
-      auto value = input("value").get<std::string>();
+      auto& value = value_input_.get();
 
       auto fname = manager.substitute_globals(filepath_);
       
@@ -290,6 +304,281 @@ namespace geoflow::nodes::core {
     void process() override;
   };
 
+  // Outputs the rows of attributes for which expression is true as a Selection, the attributes are not copied. When
+  // the optional selection input is connected (eg. from another FilterNode on the same attributes) only those rows are
+  // evaluated, so chained filters compose.
+  class FilterNode : public Node {
+    std::string expression_ = "";
+    InputHandle<Selection> selection_input_;
+    OutputHandle<Selection> selection_output_;
+    public:
+    using Node::Node;
+    void init(){
+      add_poly_input("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+      selection_input_ = add_input<Selection>("selection", true);
+      selection_output_ = add_output<Selection>("selection");
+
+      add_param(ParamString(expression_, "expression", "Rows for which this expression is true are selected"));
+    };
+    // the selection input is only waited for when it is connected
+    bool inputs_valid() override {
+      if (!poly_input("attributes").has_data()) return false;
+      return !selection_input_.terminal().has_connection() || selection_input_.has_data();
+    }
+
+    void process() override;
+  };
+
+  // Base of nodes that pass geometries of one of geometry_types() from their "geometries" input to their "geometries"
+  // output, eg. ApplySelection and SpatialSort. An output can only be connected to inputs that accept every one of its
+  // types, so the output has the one type that is selected with the geometry_type parameter. Connecting the geometry
+  // input selects its type, and because the parameter is saved with the flowchart the output has the right type again
+  // before the connections are restored. Nodes that override the hooks below must call them too.
+  class PassthroughGeometryNode : public Node {
+    protected:
+    size_t geometry_type_ = 0;
+
+    // adds the geometries input and output and the geometry_type parameter, call from init()
+    void add_passthrough_geometries(bool optional_input) {
+      add_vector_input("geometries", geometry_types(), optional_input);
+      add_vector_output("geometries", geometry_types()[geometry_type_]);
+      add_param(ParamSelector(geometry_type_names(), geometry_type_, "geometry_type", "Type of the geometries, follows the connected geometries input"));
+    }
+    // set the type of the output, connections to inputs that do not accept it are removed
+    void update_geometry_output_type() {
+      auto& output = vector_output("geometries");
+      output.set_type(geometry_types()[geometry_type_]);
+      std::vector<std::shared_ptr<gfInputTerminal>> incompatible;
+      for (auto& conn : output.get_connections()) {
+        if (auto input = conn.lock()) {
+          if (!output.is_compatible(*input)) incompatible.push_back(input);
+        }
+      }
+      for (auto& input : incompatible) output.disconnect(*input);
+    }
+    // the output only accepts the selected geometry_type, the type of the connected terminal is checked so that the
+    // geometries themselves (possibly an upstream view) are not read
+    void check_geometry_type() {
+      if (vector_input("geometries").get_connected_type() != geometry_types()[geometry_type_])
+        throw gfNodeInputDataError("geometries do not have the selected geometry_type " + geometry_type_names()[geometry_type_]);
+    }
+
+    public:
+    using Node::Node;
+    void post_parameter_load() override {
+      update_geometry_output_type();
+    }
+    void on_change_parameter(std::string name, Parameter&) override {
+      if (name == "geometry_type") update_geometry_output_type();
+    }
+    void on_connect_input(gfInputTerminal& input) override {
+      if (&input != &vector_input("geometries")) return;
+      if (auto type = geometry_type_index(vector_input("geometries").get_connected_type())) {
+        geometry_type_ = *type;
+        update_geometry_output_type();
+      }
+    }
+  };
+
+  // Outputs the selected rows of attributes and/or the selected geometries as views on the input data (see
+  // gfSingleFeatureOutputTerminal::set_view), nothing is copied here. Downstream nodes that read elements one by one
+  // read the selected rows in place, the rows are only copied for a node that asks for the whole data vector.
+  class ApplySelectionNode : public PassthroughGeometryNode {
+    InputHandle<Selection> selection_input_;
+    public:
+    using PassthroughGeometryNode::PassthroughGeometryNode;
+    void init(){
+      add_poly_input("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)}, true);
+      selection_input_ = add_input<Selection>("selection");
+      add_poly_output("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+      add_passthrough_geometries(true);
+    };
+    // attributes and geometries are only waited for when they are connected
+    bool inputs_valid() override {
+      if (!selection_input_.has_data()) return false;
+      for (auto name : {"attributes", "geometries"}) {
+        auto& iterm = *input_terminals.at(name);
+        if (iterm.has_connection() && !iterm.has_data()) return false;
+      }
+      return true;
+    }
+
+    void process(){
+      auto& selection = selection_input_.get();
+      for (auto& iterm : poly_input("attributes").sub_terminals()) {
+        auto& oterm = poly_output("attributes").add_vector(iterm->get_name(), iterm->get_type());
+        oterm.set_view(*iterm, selection);
+      }
+      if (vector_input("geometries").has_data()) {
+        check_geometry_type();
+        vector_output("geometries").set_view(*vector_input("geometries").get_connected_output(), selection);
+      }
+    };
+  };
+
+  // Area, perimeter, centroid, orientation and vertex count of polygons (including their interior rings), output as
+  // attribute columns with one value per polygon
+  class GeometryMeasuresNode : public Node {
+    InputHandle<LinearRing> polygons_;
+
+    template<typename T> void add_column(const std::string& name, const std::vector<T>& values) {
+      auto& term = poly_output("attributes").add_vector(name, typeid(T));
+      term.get_data_vec().reserve(values.size());
+      for (size_t i = 0; i < values.size(); ++i) term.push_back(T(values[i]));
+    }
+
+    public:
+    using Node::Node;
+    void init(){
+      polygons_ = add_vector_input<LinearRing>("polygons");
+      add_poly_output("attributes", {typeid(float), typeid(bool), typeid(int)});
+    };
+
+    void process(){
+      std::vector<const LinearRing*> polygons;
+      polygons.reserve(polygons_.size());
+      for (size_t i = 0; i < polygons_.size(); ++i) polygons.push_back(&polygons_[i]);
+
+      auto measures = polygon_measures(polygons);
+      add_column("area", measures.area);
+      add_column("perimeter", measures.perimeter);
+      add_column("centroid_x", measures.centroid_x);
+      add_column("centroid_y", measures.centroid_y);
+      add_column("is_ccw", measures.is_ccw);
+      add_column("vertex_count", measures.vertex_count);
+    };
+  };
+
+  // Welds the corners of a TriangleCollection into the shared vertices of an IndexedMesh
+  class WeldTrianglesNode : public Node {
+    float tolerance_ = 0;
+    InputHandle<TriangleCollection> triangles_;
+    OutputHandle<IndexedMesh> mesh_;
+    public:
+    using Node::Node;
+    void init(){
+      triangles_ = add_input<TriangleCollection>("triangles");
+      mesh_ = add_output<IndexedMesh>("mesh");
+
+      add_param(ParamFloat(tolerance_, "tolerance", "Corners that differ less than this in every coordinate become one vertex"));
+    };
+
+    void process(){
+      mesh_.set(IndexedMesh::from_triangles(triangles_.get(), tolerance_));
+    };
+  };
+
+  // Packed R-tree over the boxes of the input geometries, for nodes that need overlap or nearest neighbour queries
+  class SpatialIndexNode : public Node {
+    int node_size_ = 16;
+    public:
+    using Node::Node;
+    void init(){
+      add_input("geometries", {typeid(LinearRingCollection), typeid(PointCollection), typeid(TriangleCollection)});
+      add_output("index", typeid(SpatialIndex));
+
+      add_param(ParamBoundedInt(node_size_, 2, 256, "node_size", "Maximum number of children of an index node"));
+    };
+
+    void process(){
+      auto& geometries = input("geometries");
+      if (geometries.is_connected_type(typeid(LinearRingCollection))) {
+        output("index").set(SpatialIndex(geometries.get<LinearRingCollection&>(), node_size_));
+      } else if (geometries.is_connected_type(typeid(PointCollection))) {
+        output("index").set(SpatialIndex(geometries.get<PointCollection&>(), node_size_));
+      } else if (geometries.is_connected_type(typeid(TriangleCollection))) {
+        output("index").set(SpatialIndex(geometries.get<TriangleCollection&>(), node_size_));
+      }
+    };
+  };
+
+  // Assigns points to the polygons (with interior rings) that contain them. Outputs the polygon index for every point
+  // (-1 if outside of all polygons) and the points of every polygon in CSR form: the points of polygon i are
+  // point_indices[offsets[i]] to point_indices[offsets[i+1]]. The outputs take 8 bytes per point, 4 for the polygon
+  // index and 4 for the (32 bit) point index.
+  class PointInPolygonJoinNode : public Node {
+    InputHandle<PointCollection> points_;
+    InputHandle<LinearRing> polygons_;
+    OutputHandle<vec1i> polygon_ids_;
+    OutputHandle<std::vector<uint32_t>> offsets_;
+    OutputHandle<std::vector<uint32_t>> point_indices_;
+    public:
+    using Node::Node;
+    void init(){
+      points_ = add_input<PointCollection>("points");
+      polygons_ = add_vector_input<LinearRing>("polygons");
+      polygon_ids_ = add_output<vec1i>("polygon_ids");
+      offsets_ = add_output<std::vector<uint32_t>>("offsets");
+      point_indices_ = add_output<std::vector<uint32_t>>("point_indices");
+    };
+
+    void process(){
+      std::vector<const LinearRing*> polygons;
+      polygons.reserve(polygons_.size());
+      for (size_t i = 0; i < polygons_.size(); ++i) polygons.push_back(&polygons_[i]);
+
+      auto& ids = polygon_ids_.set(points_in_polygons(points_.get(), polygons));
+      std::vector<uint32_t> offsets, indices;
+      group_by_polygon(ids, polygons.size(), offsets, indices);
+      offsets_.set(std::move(offsets));
+      point_indices_.set(std::move(indices));
+    };
+  };
+
+  // Sorts features along a Hilbert or Morton curve through the centres of their boxes, so that features that are close
+  // in space are also close in the output. Geometries and attributes are reordered alike, order[i] is the input index
+  // of output feature i.
+  class SpatialSortNode : public PassthroughGeometryNode {
+    size_t curve_ = GF_HILBERT;
+    OutputHandle<vec1ui> order_output_;
+
+    static std::vector<std::any> permute(const std::vector<std::any>& data, const vec1ui& order) {
+      std::vector<std::any> result;
+      result.reserve(order.size());
+      for (auto i : order) result.push_back(data[i]);
+      return result;
+    }
+
+    public:
+    using PassthroughGeometryNode::PassthroughGeometryNode;
+    void init(){
+      add_poly_input("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)}, true);
+      add_poly_output("attributes", {typeid(bool), typeid(int), typeid(float), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+      order_output_ = add_output<vec1ui>("order");
+
+      add_param(ParamSelector({"Hilbert", "Morton"}, curve_, "curve", "Space filling curve to sort along"));
+      add_passthrough_geometries(false);
+    };
+    // the attributes are only waited for when they are connected
+    bool inputs_valid() override {
+      if (!vector_input("geometries").has_data()) return false;
+      return !poly_input("attributes").has_connection() || poly_input("attributes").has_data();
+    }
+
+    void process(){
+      check_geometry_type();
+      auto& geometries = vector_input("geometries").get_data_vec();
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+      vec3f centres(geometries.size());
+      parallel_for(geometries.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          auto box = geometry_box(geometries[i]);
+          centres[i] = box ? box->center() : arr3f{nan, nan, nan};
+        }
+      }, 256);
+      auto order = spatial_order(centres, SpaceFillingCurve(curve_));
+
+      vector_output("geometries") = permute(geometries, order);
+      for (auto& iterm : poly_input("attributes").sub_terminals()) {
+        if (iterm->size() != geometries.size()) {
+          throw gfNodeInputDataError("attribute " + iterm->get_name() + " has " + std::to_string(iterm->size()) + " elements, expected " + std::to_string(geometries.size()));
+        }
+        poly_output("attributes").add_vector(iterm->get_name(), iterm->get_type()) = permute(iterm->get_data_vec(), order);
+      }
+      order_output_.set(std::move(order));
+    };
+  };
+
   class NestNode : public Node {
     private:
     bool flowchart_loaded=false;
@@ -315,8 +604,8 @@ namespace geoflow::nodes::core {
         output_terminals.clear();
         nested_node_manager_->clear();
 
-        add_input(get_name()+".wait", typeid(bool));
-        add_poly_input(get_name()+".globals", {typeid(int), typeid(float), typeid(bool), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)});
+        add_input(get_name()+".wait", typeid(bool), !require_input_wait_);
+        add_poly_input(get_name()+".globals", {typeid(int), typeid(float), typeid(bool), typeid(std::string), typeid(Date), typeid(Time), typeid(DateTime)}, !require_input_globals_);
         nested_node_manager_->set_globals(parent_manager);
         // nested_outputs_.clear();
         // nested_inputs_.clear();
@@ -365,6 +654,7 @@ namespace geoflow::nodes::core {
       add_param(ParamBool(require_input_globals_, "require_input_globals", "Require input global terminal to be ready prior to running."));
       add_param(ParamBool(require_input_wait_, "require_input_wait", "Require wait terminal to be connected to something prior to running."));
       add_param(ParamBool(push_any_for_empty_sfterminal_, "push_any_for_empty_sfterminal", "Push any for empty single feature output terminals"));
+      add_param(ParamBool(use_parallel_processing, "use_parallel_processing", "Process items in parallel, largest items first. Nodes in the nested flowchart must be safe to run concurrently."));
 
     };
     bool inputs_valid() {
@@ -381,6 +671,16 @@ namespace geoflow::nodes::core {
     void post_parameter_load() {
       flowchart_loaded = load_nodes();
     }
+    std::shared_ptr<NodeManager> get_nested_flowchart() override {
+      if (!flowchart_loaded) return nullptr;
+      return copy_nested_flowchart();
+    }
+    std::optional<size_t> get_nested_item_count() override {
+      if (!flowchart_loaded) return std::nullopt;
+      auto first_input = input_terminals.begin()->second.get();
+      if (!first_input->has_data()) return std::nullopt;
+      return first_input->size();
+    }
 
     #ifdef GF_BUILD_WITH_GUI
       void gui() {
@@ -404,7 +704,9 @@ namespace geoflow::nodes::core {
 
     std::shared_ptr<NodeManager> copy_nested_flowchart() {
       auto flowchart = std::make_shared<NodeManager>(*nested_node_manager_);
-      flowchart->proj->set_data_offset(*manager.proj->data_offset);
+      if (manager.proj->data_offset.has_value())
+        flowchart->proj->set_data_offset(*manager.proj->data_offset);
+      flowchart->run_history = manager.run_history;
       // set up proxy node
       auto R = std::make_shared<NodeRegister>("ProxyRegister");
       R->register_node<ProxyNode>("Proxy");
@@ -436,132 +738,239 @@ namespace geoflow::nodes::core {
       
       for(auto& [name, proxy_output] : proxy_node->output_terminals) {
         if (proxy_output->get_family()==GF_SINGLE_FEATURE) {
-          auto& data_vec = vector_input(name).get_data_vec();
           // we need to set the correct type
           proxy_node->output(name).set_type(vector_input(name).get_connected_type());
-          proxy_node->output(name).set_from_any(data_vec[i]);
+          proxy_node->output(name).set_from_any(vector_input(name).get_any(i));
         } else {
           for (auto sub_iterm : poly_input(name).sub_terminals()) {
             auto& sub_name = sub_iterm->get_name();
             // first add sub terminal
             auto& sub_oterm = proxy_node->poly_output(name).add(sub_name, sub_iterm->get_types()[0]);
-            sub_oterm.set_from_any(sub_iterm->get_data_vec()[i]);
+            sub_oterm.set_from_any(sub_iterm->get_any(i));
           }
         }
       }
     }
 
-    void process_parallel() {
-      // repack input data
-      // assume all vector inputs have the same size
+    // clear the nested flowchart and set its globals and inputs for item i
+    void prepare_item(std::shared_ptr<NodeManager>& flowchart, const std::map<std::string, std::shared_ptr<Parameter>>& globals, size_t i) {
+      auto& proxy_node = flowchart->get_node(proxy_node_name_);
+      proxy_node->notify_children();
+      // also clear root nodes that do not depend on proxy_node
+      for (auto& [nname, node] : flowchart->get_nodes()) {
+        if(node->is_root()) {
+          node->notify_children();
+        }
+      }
+      // prep inputs
+      for (auto& [key,val] : globals) {
+        flowchart->global_flowchart_params[key] = val;
+      }
+      flowchart->global_flowchart_params["GF_I"] = std::make_shared<ParameterByValue<std::string>>(std::to_string(i), "GF_I", "");
+
+      // create globals from inputs on .globals terminal
+      auto& glterm = poly_input(get_name()+".globals");
+      for(auto& sterm : glterm.sub_terminals()) {
+        if(sterm->accepts_type(typeid(std::string))) {
+          auto& val = sterm->get<std::string>(i);
+          flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<std::string>>(val, sterm->get_name(), "global from polyinput");
+        } else if(sterm->accepts_type(typeid(int))) {
+          auto val = sterm->get<int>(i);
+          flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<int>>(val, sterm->get_name(), "global from polyinput");
+        } else if(sterm->accepts_type(typeid(float))) {
+          auto val = sterm->get<float>(i);
+          flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<float>>(val, sterm->get_name(), "global from polyinput");
+        } else if(sterm->accepts_type(typeid(bool))) {
+          auto val = sterm->get<bool>(i);
+          flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<bool>>(val, sterm->get_name(), "global from polyinput");
+        }
+      }
 
-      // std::vector<std::shared_ptr<NodeManager>> flowcharts;
-      // for(size_t i=0; i<input_size_; ++i) {
-      //   auto fc = copy_nested_flowchart();
-      //   for (auto& [key,val] : manager.global_flowchart_params) {
-      //     fc->global_flowchart_params[key] = val;
-      //   }
-      //   fc->global_flowchart_params["GF_I"] = std::make_shared<ParameterByValue<std::string>>(std::to_string(i), "GF_I", "");
-      //   set_inputs(fc, i);
-      //   flowcharts.push_back(fc);
-      // }
-
-      // tf::Executor executor;
-      // tf::Taskflow taskflow;
-      // for(auto& fc : flowcharts) {
-      //   tf::Task task = taskflow.emplace([&](){ 
-      //     auto& proxy_node = fc->get_node(proxy_node_name_);
-      //     fc->run(proxy_node, false);
-      //    });
-      // }
-      // executor.run(taskflow).wait();
+      set_inputs(flowchart, i);
+    }
+
+    // data on the marked output terminals of the nested flowchart after running one item
+    struct ItemResult {
+      struct SubTerminalData {
+        std::string name;
+        std::type_index type;
+        std::vector<std::any> data;
+      };
+      std::map<std::string, std::vector<std::any>> vector_outputs;
+      std::map<std::string, std::vector<SubTerminalData>> poly_outputs;
+      float runtime = 0;
     };
+    void collect_outputs(std::shared_ptr<NodeManager>& flowchart, ItemResult& result, size_t i) {
+      for (auto& [node_name, node] : flowchart->get_nodes()) {
+        for (auto& [term_name, output_term_] : node->output_terminals) {
+          if (output_term_->is_marked()) {
+            if (output_term_->get_family() == GF_SINGLE_FEATURE) {
+              auto output_term = (gfSingleFeatureOutputTerminal*)(output_term_.get());
+              auto& data_vec = result.vector_outputs[node_name+"."+term_name];
+              if (output_term->has_data()) {
+                data_vec = output_term->get_data_vec();
+              } else {
+                if(push_any_for_empty_sfterminal_) {
+                  std::cout << "pushing empty any for " << node_name+"."+term_name << "at i=" << i << std::endl;
+                  data_vec.push_back(std::any());
+                }
+              }
+            } else {
+              auto output_term = (gfMultiFeatureOutputTerminal*)(output_term_.get());
+              auto& sub_terms = result.poly_outputs[node_name+"."+term_name];
+              for (auto& [name, sub_term]: output_term->sub_terminals()) {
+                sub_terms.push_back({name, sub_term->get_type(), sub_term->get_data_vec()});
+              }
+            }
+          }
+        }
+      }
+    }
+    // push the collected data directly to vector outputs
+    void push_outputs(ItemResult& result, size_t i) {
+      for (auto& [name, data_vec] : result.vector_outputs) {
+        for (auto& data : data_vec) {
+          vector_output(name).push_back_any(data);
+        }
+      }
+      for (auto& [name, sub_terms] : result.poly_outputs) {
+        auto& aggregate_poly_out = poly_output(name);
+        for (auto& sub_term : sub_terms) {
+          // check if subterm already exists
+          if(!aggregate_poly_out.has_sub_terminal(sub_term.name)) {
+            aggregate_poly_out.add_vector(sub_term.name, sub_term.type);
+            // push empty any for previous elemnts
+            for(size_t j=0; i<j; ++j) {
+              aggregate_poly_out.sub_terminal(sub_term.name).push_back_any(std::any());  
+            }
+          }
+          for (auto& data : sub_term.data) {
+            aggregate_poly_out.sub_terminal(sub_term.name).push_back_any(data);
+          }
+        }
+      }
+      vector_output(get_name()+".timings").push_back(result.runtime);
+    }
 
-    void process_sequential() {
-      // repack input data
-      // assume all vector inputs have the same size
-      auto flowchart = copy_nested_flowchart();
-      auto& proxy_node = flowchart->get_node(proxy_node_name_);
-      float runtime;
-      for(size_t i=0; i<input_size_; ++i) {
-        proxy_node->notify_children();
-        // also clear root nodes that do not depend on proxy_node
-        for (auto& [nname, node] : flowchart->get_nodes()) {
-          if(node->is_root()) {
-            node->notify_children();
+    // number of vertices in a geometry, used to estimate how long an item takes to process
+    static std::optional<size_t> size_hint(const std::any& a) {
+      std::optional<size_t> n;
+      visit_geometry(a, [&n](auto& g) {
+        typedef std::decay_t<decltype(g)> T;
+        if constexpr (std::is_same_v<T, LinearRing>) {
+          n = g.vertex_count();
+          for (auto& iring : g.interior_rings()) *n += iring.size();
+        } else if constexpr (std::is_same_v<T, MultiTriangleCollection>) {
+          n = 0;
+          for (auto& tc : g.get_tricollections()) *n += tc.vertex_count();
+        } else if constexpr (std::is_same_v<T, Mesh>) {
+          n = 0;
+          for (auto& polygon : g.get_polygons()) *n += polygon.vertex_count();
+        } else {
+          n = g.vertex_count();
+        }
+      });
+      return n;
+    }
+    // order in which to process the items: largest first if the vector inputs hold geometries, otherwise
+    // in input order. Putting the big items first prevents a long running item from ending up at the tail of a
+    // parallel run
+    std::vector<size_t> item_order() {
+      std::vector<size_t> order(input_size_);
+      std::iota(order.begin(), order.end(), 0);
+      std::vector<size_t> hints(input_size_, 0);
+      bool has_hints = false;
+      for (auto& [name, iterm] : input_terminals) {
+        if (iterm->get_family() != GF_SINGLE_FEATURE || !iterm->has_data()) continue;
+        auto& data_vec = vector_input(name).get_data_vec();
+        if (data_vec.size() != input_size_) continue;
+        for (size_t i=0; i<input_size_; ++i) {
+          if (auto hint = size_hint(data_vec[i])) {
+            hints[i] += *hint;
+            has_hints = true;
           }
         }
-        // prep inputs
-        for (auto& [key,val] : manager.global_flowchart_params) {
-          flowchart->global_flowchart_params[key] = val;
+      }
+      if (has_hints) {
+        std::stable_sort(order.begin(), order.end(), [&hints](size_t a, size_t b) {
+          return hints[a] > hints[b];
+        });
+      }
+      return order;
+    }
+
+    void process_parallel() {
+      // each worker processes items on its own copy of the nested flowchart, items are handed out largest
+      // first. Results are pushed to the outputs in input order once all items are done.
+      auto order = item_order();
+      size_t n_workers = std::min(get_concurrency(), input_size_);
+      std::vector<std::shared_ptr<NodeManager>> flowcharts;
+      for (size_t w=0; w<n_workers; ++w) {
+        flowcharts.push_back(copy_nested_flowchart());
+      }
+      // take a snapshot of the globals so that workers do not read from the parent manager
+      auto globals = manager.global_flowchart_params;
+      std::vector<ItemResult> results(input_size_);
+
+      auto process_item = [&](std::shared_ptr<NodeManager>& flowchart, size_t i) {
+        prepare_item(flowchart, globals, i);
+        std::cout << "Processing item " << i+1 << "/" << input_size_ << "\n";
+        auto t_start = std::chrono::steady_clock::now(); // Wall time
+        flowchart->run_all(false);
+        std::chrono::duration<float, std::milli> t_run = std::chrono::steady_clock::now() - t_start;
+        results[i].runtime = t_run.count();
+        std::cout << ".. " << results[i].runtime << "ms (item " << i+1 << ")\n";
+        collect_outputs(flowchart, results[i], i);
+      };
+
+      // all items need to share the same data offset. If it is not yet known, the first item sets it.
+      size_t k_start = 0;
+      if (!manager.proj->data_offset.has_value() && order.size()) {
+        process_item(flowcharts[0], order[k_start++]);
+        if (flowcharts[0]->proj->data_offset.has_value()) {
+          for (auto& flowchart : flowcharts) {
+            flowchart->proj->set_data_offset(*flowcharts[0]->proj->data_offset);
+          }
         }
-        flowchart->global_flowchart_params["GF_I"] = std::make_shared<ParameterByValue<std::string>>(std::to_string(i), "GF_I", "");
-
-        // create globals from inputs on .globals terminal
-        auto& glterm = poly_input(get_name()+".globals");
-        for(auto& sterm : glterm.sub_terminals()) {
-          if(sterm->accepts_type(typeid(std::string))) {
-            auto& val = sterm->get<std::string>(i);
-            flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<std::string>>(val, sterm->get_name(), "global from polyinput");
-          } else if(sterm->accepts_type(typeid(int))) {
-            auto val = sterm->get<int>(i);
-            flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<int>>(val, sterm->get_name(), "global from polyinput");
-          } else if(sterm->accepts_type(typeid(float))) {
-            auto val = sterm->get<float>(i);
-            flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<float>>(val, sterm->get_name(), "global from polyinput");
-          } else if(sterm->accepts_type(typeid(bool))) {
-            auto val = sterm->get<bool>(i);
-            flowchart->global_flowchart_params[sterm->get_name()] = std::make_shared<ParameterByValue<bool>>(val, sterm->get_name(), "global from polyinput");
+      }
+
+      std::atomic<size_t> next{k_start};
+      std::atomic<bool> failed{false};
+      parallel_invoke(n_workers, [&](size_t w) {
+        size_t k;
+        while (!failed && (k = next++) < order.size()) {
+          try {
+            process_item(flowcharts[w], order[k]);
+          } catch (...) {
+            failed = true;
+            throw;
           }
         }
+      });
+
+      for(size_t i=0; i<input_size_; ++i) {
+        push_outputs(results[i], i);
+      }
+    };
 
-        set_inputs(flowchart, i);
+    void process_sequential() {
+      // repack input data
+      // assume all vector inputs have the same size
+      auto flowchart = copy_nested_flowchart();
+      for(size_t i=0; i<input_size_; ++i) {
+        prepare_item(flowchart, manager.global_flowchart_params, i);
         // run
         std::cout << "Processing item " << i+1 << "/" << input_size_ << "\n";
-        std::clock_t c_start = std::clock(); // CPU time
-        // auto t_start = std::chrono::high_resolution_clock::now(); // Wall time
+        // wall time, like process_parallel and the run history
+        auto t_start = std::chrono::steady_clock::now();
         flowchart->run_all(false);
-        std::clock_t c_end = std::clock(); // CPU time
-        // auto t_end = std::chrono::high_resolution_clock::now(); // Wall time
-        runtime = 1000.0 * (c_end-c_start) / CLOCKS_PER_SEC;
-        std::cout << ".. " << runtime << "ms\n";
+        std::chrono::duration<float, std::milli> t_run = std::chrono::steady_clock::now() - t_start;
+        ItemResult result;
+        result.runtime = t_run.count();
+        std::cout << ".. " << result.runtime << "ms\n";
         // collect outputs and push directly to vector outputs
-        for (auto& [node_name, node] : flowchart->get_nodes()) {
-          for (auto& [term_name, output_term_] : node->output_terminals) {
-            if (output_term_->is_marked()) {
-              if (output_term_->get_family() == GF_SINGLE_FEATURE) {
-                auto output_term = (gfSingleFeatureOutputTerminal*)(output_term_.get());
-                if (output_term->has_data()) {
-                  for (auto& data : output_term->get_data_vec()) {
-                    vector_output(node_name+"."+term_name).push_back_any(data);
-                  }
-                } else {
-                  if(push_any_for_empty_sfterminal_) {
-                    std::cout << "pushing empty any for " << node_name+"."+term_name << "at i=" << i << std::endl;
-                    vector_output(node_name+"."+term_name).push_back_any(std::any());
-                  }
-                }
-              } else {
-                auto output_term = (gfMultiFeatureOutputTerminal*)(output_term_.get());
-                auto& aggregate_poly_out = poly_output(node_name+"."+term_name);
-                for (auto& [name, sub_term]: output_term->sub_terminals()) {
-                  // check if subterm already exists
-                  if(!aggregate_poly_out.has_sub_terminal(name)) {
-                    aggregate_poly_out.add_vector(name, sub_term->get_type());
-                    // push empty any for previous elemnts
-                    for(size_t j=0; i<j; ++j) {
-                      aggregate_poly_out.sub_terminal(name).push_back_any(std::any());  
-                    }
-                  }
-                  for (auto& data : sub_term->get_data_vec()) {
-                    aggregate_poly_out.sub_terminal(name).push_back_any(data);
-                  }
-                }
-              }
-            }
-          }
-        }
-        vector_output(get_name()+".timings").push_back(runtime);
+        collect_outputs(flowchart, result, i);
+        push_outputs(result, i);
       }
     };
 
@@ -569,6 +978,8 @@ namespace geoflow::nodes::core {
       if(flowchart_loaded) {
         auto first_input = input_terminals.begin()->second.get();
         input_size_ = first_input->size();
+        // pick up a data offset that a node running at the same time has set
+        manager.proj->sync_data_offset();
         std::cout << "Begin processing for NestNode " << get_name() << "\n";
         if (use_parallel_processing) {
           process_parallel();
@@ -579,4 +990,54 @@ namespace geoflow::nodes::core {
       }
     }
   };
+
+  // Partitions features into spatially compact chunks of about chunk_size features or vertices, with a kd-tree over
+  // the centres of their boxes. Every output has one element per chunk, so each chunk is one NestedFlowchart item:
+  // indices holds the sorted indices of its features, chunks the same rows as a Selection and boxes the box of its
+  // features. NestNode only passes a chunk's own element to the nested flowchart, so it has to load the features
+  // itself (eg. with a reader on the same source) and can then pick the chunk with ApplySelection (geometry_type set to
+  // the type of the features).
+  class TilePartitionerNode : public Node {
+    int chunk_size_ = 1000;
+    size_t size_by_ = 0;
+    VectorOutput<vec1ui> indices_;
+    VectorOutput<Selection> chunks_;
+    VectorOutput<Box> boxes_;
+    public:
+    using Node::Node;
+    void init(){
+      add_vector_input("geometries", geometry_types());
+      indices_ = add_vector_output<vec1ui>("indices");
+      chunks_ = add_vector_output<Selection>("chunks");
+      boxes_ = add_vector_output<Box>("boxes");
+
+      add_param(ParamInt(chunk_size_, "chunk_size", "Target size of a chunk"));
+      add_param(ParamSelector({"features", "vertices"}, size_by_, "size_by", "Measure chunk size by the number of features or the number of vertices"));
+    };
+
+    void process(){
+      auto& geometries = vector_input("geometries").get_data_vec();
+      const float nan = std::numeric_limits<float>::quiet_NaN();
+      std::vector<std::optional<Box>> feature_boxes(geometries.size());
+      vec3f centres(geometries.size());
+      vec1ui weights(geometries.size(), 1);
+      parallel_for(geometries.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+          feature_boxes[i] = geometry_box(geometries[i]);
+          centres[i] = feature_boxes[i] ? feature_boxes[i]->center() : arr3f{nan, nan, nan};
+          if (size_by_ == 1) weights[i] = NestNode::size_hint(geometries[i]).value_or(1);
+        }
+      }, 256);
+
+      for (auto& group : kd_partition(centres, weights, size_t(std::max(chunk_size_, 1)))) {
+        Box box;
+        for (auto i : group) {
+          if (feature_boxes[i]) box.add(*feature_boxes[i]);
+        }
+        indices_.push_back(group);
+        chunks_.push_back(Selection(std::move(group), geometries.size()));
+        boxes_.push_back(box);
+      }
+    };
+  };
 }
\ No newline at end of file
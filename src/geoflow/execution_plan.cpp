@@ -0,0 +1,301 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <queue>
+#include <set>
+#include <sstream>
+
+#include <nlohmann/json.hpp>
+
+#include "execution_plan.hpp"
+
+using json = nlohmann::json;
+
+namespace geoflow {
+
+  static PlanStep make_step(NodeManager& manager, Node& node) {
+    PlanStep step;
+    step.node_name = node.get_name();
+    step.type_name = node.get_type_name();
+    step.register_name = node.get_register().get_name();
+    step.memory_estimate = node.estimate_memory();
+    if (manager.run_history)
+      step.estimated_ms = manager.run_history->estimate_ms(manager.history_key(node));
+    step.critical_path_ms = manager.estimated_critical_path_ms(node);
+    for (auto& [name, param] : node.parameters) {
+      if (!param->is_type(typeid(std::string))) continue;
+      auto value = param->as_json();
+      if (value.is_string() && value.get<std::string>().find("{{") != std::string::npos)
+        step.parameters[name] = manager.substitute_globals(value.get<std::string>());
+    }
+    return step;
+  }
+
+  ExecutionPlan::ExecutionPlan(NodeManager& manager) {
+    for (auto& [name, param] : manager.global_flowchart_params) {
+      globals[name] = param->as_json().dump();
+    }
+    connections = dump_connections(manager.dump_nodes());
+    std::map<std::string, std::set<std::string>> upstream;
+    for (auto& [out_node, in_node, out_term, in_term] : connections) {
+      upstream[in_node].insert(out_node);
+    }
+
+    // a node runs if it is enabled, all of its required inputs are connected and all of its upstream nodes run
+    std::map<std::string, std::string> pruned_reasons;
+    std::function<std::string(Node&)> pruned_reason = [&](Node& node) -> std::string {
+      auto it = pruned_reasons.find(node.get_name());
+      if (it != pruned_reasons.end()) return it->second;
+
+      std::string reason;
+      if (!node.autorun) {
+        reason = "autorun is disabled";
+      } else if (!node.parameters_valid()) {
+        reason = "parameters are not valid";
+      } else {
+        for (auto& [name, iterm] : node.input_terminals) {
+          if (!iterm->has_connection() && !iterm->is_optional()) {
+            reason = "input " + name + " is not connected";
+            break;
+          }
+        }
+      }
+      if (reason.empty()) {
+        for (auto& up_name : upstream[node.get_name()]) {
+          if (!pruned_reason(*manager.get_nodes().at(up_name)).empty()) {
+            reason = "upstream node " + up_name + " does not run";
+            break;
+          }
+        }
+      }
+      return pruned_reasons[node.get_name()] = reason;
+    };
+
+    // replay the scheduler: roots longest critical path first, then ready nodes by priority (see NodeManager::queue)
+    manager.update_critical_paths();
+    std::vector<NodeHandle> roots;
+    for (auto& node : manager.dump_nodes()) {
+      if (node->is_root() && pruned_reason(*node).empty())
+        roots.push_back(node);
+    }
+    std::sort(roots.begin(), roots.end(), [](const NodeHandle& a, const NodeHandle& b) {
+      return a->get_name() < b->get_name();
+    });
+    std::stable_sort(roots.begin(), roots.end(), [&manager](const NodeHandle& a, const NodeHandle& b) {
+      return manager.estimated_critical_path_ms(*a) > manager.estimated_critical_path_ms(*b);
+    });
+
+    typedef std::tuple<double, size_t, Node*> QueueEntry;
+    auto compare = [](const QueueEntry& a, const QueueEntry& b) {
+      if (std::get<0>(a) != std::get<0>(b)) return std::get<0>(a) < std::get<0>(b);
+      return std::get<1>(a) > std::get<1>(b);
+    };
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, decltype(compare)> ready(compare);
+    std::set<std::string> queued, done;
+    size_t seq = 0;
+    auto queue = [&](Node& node) {
+      queued.insert(node.get_name());
+      ready.push({manager.estimated_critical_path_ms(node), seq++, &node});
+    };
+    for (auto& root : roots) {
+      if (queued.count(root->get_name())) continue;
+      queue(*root);
+      while (!ready.empty()) {
+        auto node = std::get<2>(ready.top());
+        ready.pop();
+        done.insert(node->get_name());
+
+        auto step = make_step(manager, *node);
+        step.order = steps.size() + 1;
+        if (auto nested_flowchart = node->get_nested_flowchart()) {
+          step.nested = std::make_shared<ExecutionPlan>(*nested_flowchart);
+          step.item_count = node->get_nested_item_count();
+          if (!step.estimated_ms && step.item_count && step.nested->estimated_total_ms)
+            step.estimated_ms = *step.item_count * *step.nested->estimated_total_ms;
+        }
+        steps.push_back(step);
+
+        for (auto& child : node->get_child_nodes()) {
+          if (queued.count(child->get_name()) || !pruned_reason(*child).empty()) continue;
+          auto& child_upstream = upstream[child->get_name()];
+          bool is_ready = std::all_of(child_upstream.begin(), child_upstream.end(), [&done](const std::string& name) {
+            return done.count(name) > 0;
+          });
+          if (is_ready) queue(*child);
+        }
+      }
+    }
+
+    std::vector<NodeHandle> pruned_nodes;
+    for (auto& node : manager.dump_nodes()) {
+      if (!done.count(node->get_name())) pruned_nodes.push_back(node);
+    }
+    std::sort(pruned_nodes.begin(), pruned_nodes.end(), [](const NodeHandle& a, const NodeHandle& b) {
+      return a->get_name() < b->get_name();
+    });
+    for (auto& node : pruned_nodes) {
+      auto step = make_step(manager, *node);
+      step.pruned_reason = pruned_reason(*node);
+      // nodes that are waiting on each other, can only happen if the flowchart contains a loop
+      if (step.pruned_reason.empty()) step.pruned_reason = "inputs never become ready";
+      steps.push_back(step);
+    }
+
+    for (auto& step : steps) {
+      if (!step.runs()) continue;
+      critical_path_ms = std::max(critical_path_ms, step.critical_path_ms);
+      if (manager.run_history)
+        estimated_total_ms = estimated_total_ms.value_or(0) + step.estimated_ms.value_or(0);
+    }
+  }
+
+  size_t ExecutionPlan::run_count() const {
+    return std::count_if(steps.begin(), steps.end(), [](const PlanStep& step) { return step.runs(); });
+  }
+
+  void ExecutionPlan::write_text(std::ostream& os, const std::string& indent) const {
+    const double MB = 1024.0 * 1024.0;
+    auto flags = os.flags();
+    os << std::fixed << std::setprecision(1);
+    os << indent << "Execution plan: " << run_count() << " of " << steps.size() << " nodes run\n";
+    if (estimated_total_ms)
+      os << indent << "Estimated runtime: " << *estimated_total_ms << " ms sequential, " << critical_path_ms << " ms critical path\n";
+    if (indent.empty() && !globals.empty()) {
+      os << "Globals:\n";
+      for (auto& [name, value] : globals) {
+        os << "  " << name << " = " << value << "\n";
+      }
+    }
+    for (auto& step : steps) {
+      if (!step.runs()) continue;
+      os << indent << std::setw(4) << step.order << ". " << step.node_name << " [" << step.register_name << "." << step.type_name << "]";
+      if (step.estimated_ms) os << " ~" << *step.estimated_ms << " ms";
+      if (step.memory_estimate) os << ", " << step.memory_estimate / MB << " MB";
+      os << "\n";
+      for (auto& [name, value] : step.parameters) {
+        os << indent << "        " << name << " = " << value << "\n";
+      }
+      if (step.nested) {
+        os << indent << "        nested flowchart";
+        if (step.item_count) os << " for " << *step.item_count << " items";
+        os << ":\n";
+        step.nested->write_text(os, indent + "        ");
+      }
+    }
+    if (run_count() < steps.size()) {
+      os << indent << "Not running:\n";
+      for (auto& step : steps) {
+        if (step.runs()) continue;
+        os << indent << "   - " << step.node_name << " [" << step.register_name << "." << step.type_name << "]: " << step.pruned_reason << "\n";
+      }
+    }
+    os.flags(flags);
+  }
+
+  static std::string dot_escape(const std::string& text) {
+    std::string escaped;
+    for (auto c : text) {
+      if (c == '"') escaped += '\\';
+      escaped += c;
+    }
+    return escaped;
+  }
+  void ExecutionPlan::write_dot_body(std::ostream& os, const std::string& prefix, const std::string& indent) const {
+    for (auto& step : steps) {
+      std::stringstream label;
+      label << std::fixed << std::setprecision(1);
+      if (step.runs()) label << step.order << ". ";
+      label << step.node_name << "\\n" << step.type_name;
+      if (step.estimated_ms) label << "\\n~" << *step.estimated_ms << " ms";
+      if (step.item_count) label << "\\n" << *step.item_count << " items";
+      if (!step.runs()) label << "\\n(" << step.pruned_reason << ")";
+      os << indent << "\"" << dot_escape(prefix + step.node_name) << "\" [label=\"" << dot_escape(label.str()) << "\"";
+      if (!step.runs()) os << ", style=dashed, color=gray, fontcolor=gray";
+      os << "];\n";
+      if (step.nested) {
+        os << indent << "subgraph \"cluster_" << dot_escape(prefix + step.node_name) << "\" {\n";
+        os << indent << "  label=\"" << dot_escape(step.node_name) << "\";\n";
+        step.nested->write_dot_body(os, prefix + step.node_name + "/", indent + "  ");
+        os << indent << "}\n";
+      }
+    }
+    for (auto& [out_node, in_node, out_term, in_term] : connections) {
+      os << indent << "\"" << dot_escape(prefix + out_node) << "\" -> \"" << dot_escape(prefix + in_node)
+         << "\" [label=\"" << dot_escape(out_term + " : " + in_term) << "\"];\n";
+    }
+  }
+  void ExecutionPlan::write_dot(std::ostream& os) const {
+    os << "digraph plan {\n";
+    os << "  rankdir=LR;\n";
+    os << "  node [shape=box];\n";
+    write_dot_body(os, "", "  ");
+    os << "}\n";
+  }
+
+  static json plan_to_json(const ExecutionPlan& plan) {
+    json j;
+    j["globals"] = json::object();
+    for (auto& [name, value] : plan.globals) {
+      j["globals"][name] = json::parse(value);
+    }
+    if (plan.estimated_total_ms) j["estimated_total_ms"] = *plan.estimated_total_ms;
+    j["critical_path_ms"] = plan.critical_path_ms;
+    j["steps"] = json::array();
+    for (auto& step : plan.steps) {
+      json s;
+      s["name"] = step.node_name;
+      s["type"] = step.type_name;
+      s["register"] = step.register_name;
+      s["runs"] = step.runs();
+      if (step.runs()) s["order"] = step.order;
+      else s["pruned_reason"] = step.pruned_reason;
+      if (step.estimated_ms) s["estimated_ms"] = *step.estimated_ms;
+      s["critical_path_ms"] = step.critical_path_ms;
+      if (step.memory_estimate) s["memory_estimate"] = step.memory_estimate;
+      if (!step.parameters.empty()) s["parameters"] = step.parameters;
+      if (step.item_count) s["item_count"] = *step.item_count;
+      if (step.nested) s["nested"] = plan_to_json(*step.nested);
+      j["steps"].push_back(s);
+    }
+    j["connections"] = json::array();
+    for (auto& [out_node, in_node, out_term, in_term] : plan.connections) {
+      j["connections"].push_back({{"from", out_node + "." + out_term}, {"to", in_node + "." + in_term}});
+    }
+    return j;
+  }
+  void ExecutionPlan::write_json(std::ostream& os) const {
+    os << std::setw(2) << plan_to_json(*this) << std::endl;
+  }
+
+  void ExecutionPlan::write(const std::string& filepath) const {
+    std::ofstream ofs(filepath);
+    if (!ofs.is_open())
+      throw gfIOError("Unable to open " + filepath + " for writing");
+    auto ends_with = [&filepath](const std::string& ext) {
+      return filepath.size() >= ext.size() && filepath.compare(filepath.size() - ext.size(), ext.size(), ext) == 0;
+    };
+    if (ends_with(".dot") || ends_with(".gv"))
+      write_dot(ofs);
+    else if (ends_with(".json"))
+      write_json(ofs);
+    else
+      write_text(ofs);
+  }
+}
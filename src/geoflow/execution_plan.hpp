@@ -0,0 +1,82 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <map>
+#include <memory>
+#include <optional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "geoflow.hpp"
+
+namespace geoflow {
+
+  class ExecutionPlan;
+
+  struct PlanStep {
+    std::string node_name;
+    std::string type_name;
+    std::string register_name;
+    // position in the run order, starting at 1. 0 for nodes that do not run
+    size_t order = 0;
+    // reason why the node does not run, empty if it does
+    std::string pruned_reason;
+    // mean runtime from the run history
+    std::optional<double> estimated_ms;
+    // estimated time from the start of this node until all of its descendants are done
+    double critical_path_ms = 0;
+    size_t memory_estimate = 0;
+    // string parameters that refer to globals, after global substitution
+    std::map<std::string, std::string> parameters;
+    // number of times a nested flowchart runs, if known before processing
+    std::optional<size_t> item_count;
+    std::shared_ptr<ExecutionPlan> nested;
+
+    bool runs() const { return pruned_reason.empty(); };
+  };
+
+  // What NodeManager::run_all would execute, determined without calling process() on any node. Nodes are listed in the
+  // order the (sequential) scheduler would run them, followed by the nodes that would not run. Whether a node runs is
+  // decided from its autorun flag, parameters_valid() and its connections, not from its inputs_valid() override.
+  class ExecutionPlan {
+    public:
+    std::vector<PlanStep> steps;
+    // <output_node, input_node, output_term, input_term>, as returned by dump_connections
+    ConnectionList connections;
+    // global values as json strings
+    std::map<std::string, std::string> globals;
+    // sum of the estimated runtimes of the nodes that run, if there is a run history
+    std::optional<double> estimated_total_ms;
+    // longest estimated chain of nodes, ie. the runtime with unlimited jobs
+    double critical_path_ms = 0;
+
+    ExecutionPlan(NodeManager& manager);
+
+    size_t run_count() const;
+
+    void write_text(std::ostream& os, const std::string& indent="") const;
+    void write_dot(std::ostream& os) const;
+    void write_json(std::ostream& os) const;
+    // write in the format that matches the file extension (.dot, .gv, .json), otherwise as text
+    void write(const std::string& filepath) const;
+
+    private:
+    void write_dot_body(std::ostream& os, const std::string& prefix, const std::string& indent) const;
+  };
+}
@@ -21,8 +21,17 @@
 #include <chrono>
 #include <ctime>
 #include <cstdlib>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#ifdef __GNUG__
+#include <cxxabi.h>
+#endif
 
 #include "geoflow.hpp"
+#include "string_template.hpp"
 
 using namespace geoflow;
 
@@ -39,6 +48,32 @@ std::string random_string(size_t length) {
   return str;
 }
 
+// readable list of type names for error messages
+static std::string type_names(const std::vector<std::type_index>& types) {
+  std::string names;
+  for (auto& type : types) {
+    if (!names.empty()) names += ", ";
+  #ifdef __GNUG__
+    int status;
+    char* demangled = abi::__cxa_demangle(type.name(), nullptr, nullptr, &status);
+    names += status == 0 ? demangled : type.name();
+    std::free(demangled);
+  #else
+    names += type.name();
+  #endif
+  }
+  return "(" + names + ")";
+}
+
+// texts that are substituted over and over are few (parameter values), a cache that grows beyond this is cleared so
+// that generated texts can not fill it
+static const size_t max_cached_templates = 1024;
+
+// outputs of a node that is still being processed are not ready to be read, and may be written to by another thread
+static bool is_processing(const gfTerminal& term) {
+  return term.get_parent().status_ == GF_NODE_PROCESSING;
+}
+
 bool gfTerminal::accepts_type(std::type_index ttype) const {
   for (auto& t : types_) {
     if (t==ttype) 
@@ -84,12 +119,14 @@ bool gfSingleFeatureInputTerminal::has_connection() {
 }
 bool gfSingleFeatureInputTerminal::has_data() const {
   if (auto output_term = connected_output_.lock()) {
+    if (is_processing(*output_term)) return false;
     return output_term->has_data();
   }
   return false;
 }
 bool gfSingleFeatureInputTerminal::is_touched() {
   if (auto output_term = connected_output_.lock()) {
+    if (is_processing(*output_term)) return false;
     return output_term->is_touched();
   }
   return false;
@@ -100,25 +137,31 @@ void gfSingleFeatureInputTerminal::connect_output(gfOutputTerminal& output_term)
     output->disconnect(*this);
   }
   connected_output_ = output_term.get_ptr();
+  // the families of connected terminals are checked in gfOutputTerminal::is_compatible()
+  connected_output_ptr_ = static_cast<gfSingleFeatureOutputTerminal*>(&output_term);
 }
 void gfSingleFeatureInputTerminal::disconnect_output(gfOutputTerminal& output_term) {
   connected_output_.reset();
+  connected_output_ptr_ = nullptr;
+}
+const std::any& gfSingleFeatureInputTerminal::get_any(size_t i) const {
+  if (!connected_output_ptr_)
+    throw gfIOError("Input terminal is not connected (" + get_full_name() + ")");
+  return connected_output_ptr_->get_any(i);
 }
 const std::vector<std::any>& gfSingleFeatureInputTerminal::get_data_vec() const {
-  auto output_term = connected_output_.lock();
-  auto sot = (gfSingleFeatureOutputTerminal*)(output_term.get());
-  return sot->get_data_vec();
+  return connected_output_ptr_->get_data_vec();
 }
 size_t gfSingleFeatureInputTerminal::size() const {
-  auto output_term = connected_output_.lock();
-  auto sot = (gfSingleFeatureOutputTerminal*)(output_term.get());
-  return sot->size(); 
+  if (!connected_output_ptr_) return 0;
+  return connected_output_ptr_->size(); 
 }
 
 
 gfOutputTerminal::~gfOutputTerminal() {
   for(auto& conn : connections_) {
     if (auto in = conn.lock()) {
+      in->disconnect_output(*this);
       in->clear();
     }
   }
@@ -154,13 +197,15 @@ std::set<NodeHandle> gfOutputTerminal::get_child_nodes() {
 void gfOutputTerminal::connect(gfInputTerminal& in) {
     //check type compatibility
   if (!is_compatible(in))
-    throw gfNodeTerminalError("Failed to connect output " +get_name()+ " from "+parent_.get_name()+" to input " + in.get_name() + " from " +in.parent_.get_name()+ ". Terminals have incompatible types!");
+    throw gfNodeTerminalError("Failed to connect output " +get_name()+ " from "+parent_.get_name()+" to input " + in.get_name() + " from " +in.parent_.get_name()+ ". Terminals have incompatible types! Output provides "
+      + type_names(get_types()) + ", input accepts " + type_names(in.get_types()) + (get_family()!=in.get_family() && in.get_family()!=GF_MULTI_FEATURE ? " (and the terminal families differ)" : ""));
     
   if (detect_loop(*this, in))
     throw gfNodeTerminalError("Failed to connect output " +get_name()+ " from "+parent_.get_name()+" to input " + in.get_name() + " from " +in.parent_.get_name()+ ". Loop detected!");
 
   in.connect_output(*this);
   connections_.insert(in.get_ptr());
+  parent_.manager.invalidate_flowchart_hash();
   parent_.on_connect_output(*this);
   in.get_parent().on_connect_input(in);
   if (has_data() || is_touched()) {
@@ -169,6 +214,7 @@ void gfOutputTerminal::connect(gfInputTerminal& in) {
 };
 void gfOutputTerminal::disconnect(gfInputTerminal& in) {
   connections_.erase(in.get_ptr());
+  parent_.manager.invalidate_flowchart_hash();
   in.disconnect_output(*this);
   in.clear();
   in.parent_.notify_children();
@@ -181,11 +227,48 @@ void gfOutputTerminal::disconnect(gfInputTerminal& in) {
 //   return data_.has_value();
 // }
 void gfSingleFeatureOutputTerminal::clear() {
+  reset_view();
   data_.clear();
   is_touched_ = false;
 }
 bool gfSingleFeatureOutputTerminal::has_data() const {
-  return data_.size()!=0;
+  return size()!=0;
+}
+void gfSingleFeatureOutputTerminal::set_view(const gfSingleFeatureOutputTerminal& source, const Selection& selection) {
+  if (selection.source_size() != source.size())
+    throw gfNodeInputDataError("Selection of a source with " + std::to_string(selection.source_size()) + " elements can not be applied to " + std::to_string(source.size()) + " elements (" + get_full_name() + ")");
+  if (!accepts_type(source.get_type()))
+    throw gfException("illegal type for gfSingleFeatureOutputTerminal (" + get_full_name() + ")");
+  reset_view();
+  data_.clear();
+  if (source.view_source_) {
+    view_source_ = source.view_source_;
+    view_selection_ = source.view_selection_.compose(selection);
+  } else {
+    view_source_ = std::static_pointer_cast<const gfSingleFeatureOutputTerminal>(source.shared_from_this());
+    view_selection_ = selection;
+  }
+  touch();
+}
+void gfSingleFeatureOutputTerminal::copy_view() const {
+  // a view can be read by several nodes running at the same time
+  std::lock_guard<std::mutex> lock(view_mutex_);
+  if (view_copied_) return;
+  std::vector<std::any> rows;
+  rows.reserve(view_selection_.size());
+  for (auto i : view_selection_) rows.push_back(view_source_->get_any(i));
+  data_ = std::move(rows);
+  view_copied_ = true;
+}
+void gfSingleFeatureOutputTerminal::own_data() {
+  if (!view_source_) return;
+  if (!view_copied_) copy_view();
+  reset_view();
+}
+void gfSingleFeatureOutputTerminal::reset_view() {
+  view_source_.reset();
+  view_selection_ = Selection();
+  view_copied_ = false;
 }
 
 gfMultiFeatureInputTerminal::~gfMultiFeatureInputTerminal(){
@@ -216,9 +299,11 @@ void gfMultiFeatureInputTerminal::push_term_ref(gfOutputTerminal* term_ptr) {
 }
 void gfMultiFeatureInputTerminal::rebuild_terminal_refs() {
   sub_terminals_.clear();
+  ++sub_terminals_version_;
   // vector_terminals_.clear();
   for (auto& wptr : connected_outputs_) {
     if (auto term = wptr.lock()) {
+      if (is_processing(*term)) continue;
       auto term_ptr = term.get();
       if (auto poly_term_ptr = dynamic_cast<gfMultiFeatureOutputTerminal*>(term_ptr)) {
         for (auto& [name, sub_term] : poly_term_ptr->sub_terminals()) {
@@ -243,7 +328,7 @@ bool gfMultiFeatureInputTerminal::has_data() const {
     return false;
   for (auto output_term_ : connected_outputs_){
     if (auto output_term = output_term_.lock()) {
-      if (!output_term->has_data()) {
+      if (is_processing(*output_term) || !output_term->has_data()) {
         return false;
       }
     }
@@ -338,6 +423,13 @@ std::set<NodeHandle> Node::get_child_nodes() {
 const ParameterMap& Node::dump_params() {
   return parameters;
 }
+size_t Node::parameters_version() const {
+  size_t version = 0;
+  for (auto& [name, param] : parameters) {
+    version += param->get_version();
+  }
+  return version;
+}
 // void Node::preprocess() {
 //   for (auto& [name, oG] : outputGroups) {
 //     oG->is_propagated = false;
@@ -354,7 +446,7 @@ bool Node::parameters_valid() {
   return true;
 }
 bool Node::update_status() {
-  auto status_before = status_;
+  gfNodeStatus status_before = status_;
   if (inputs_valid())
     status_ = GF_NODE_READY;
   else
@@ -421,53 +513,80 @@ std::string Node::debug_info() {
 }
 
 std::string Node::substitute_from_term(const std::string& textt, gfMultiFeatureInputTerminal& term, const size_t& i) {
-  size_t start_pos=0;
-  std::string text(textt);
-  while(true) {
-    auto open = text.find("[[", start_pos);
-    if (open==std::string::npos) break;
-
-    auto close = text.find("]]", start_pos);
-    if (close==std::string::npos) break;
-    open+=2;
-    auto len = close-open;
-    std::string attr_name = text.substr(open, len);
-    for(auto& sterm : term.sub_terminals()) {
-      if (sterm->get_name() == attr_name) {
-        if(sterm->accepts_type(typeid(std::string))) {
-          auto& val = sterm->get<std::string>(i);
-          text.replace(open-2, len+4, val);
-        } else if(sterm->accepts_type(typeid(int))) {
-          auto val = sterm->get<int>(i);
-          text.replace(open-2, len+4, std::to_string(val));
-        } else if(sterm->accepts_type(typeid(float))) {
-          auto val = sterm->get<float>(i);
-          text.replace(open-2, len+4, std::to_string(val));
-        } else if(sterm->accepts_type(typeid(bool))) {
-          auto val = sterm->get<bool>(i);
-          if (val)
-            text.replace(open-2, len+4, "true");
-          else
-            text.replace(open-2, len+4, "false");
-        } else {
-          // throw warning that subtitute param is not found
-          start_pos = close;
-          throw gfException("subtitute param is not found");
-        }
-      }  else {
-        // throw warning that subtitute param is not subtituted
-        start_pos = close;
-        throw gfException("subtitute param is not subtituted: " + attr_name);
-      }
-    }
+  if (attribute_templates_.size() > max_cached_templates) attribute_templates_.clear();
+  auto& cached = attribute_templates_[textt];
+  if (!cached.text) {
+    cached.text = std::make_shared<StringTemplate>(textt);
+    cached.term = nullptr;
+  }
+  if (cached.term != &term || cached.term_version != term.sub_terminals_version()) {
+    cached.text->bind_attributes(term);
+    cached.term = &term;
+    cached.term_version = term.sub_terminals_version();
   }
-  return text;
+  return cached.text->render(i);
 }
 
 void NodeManager::queue(std::shared_ptr<Node> n) {
-  node_queue.push(n);
+  double priority = 0;
+  auto it = critical_path_ms_.find(n.get());
+  if (it != critical_path_ms_.end())
+    priority = it->second;
+  node_queue.push({priority, queue_seq_++, n});
+}
+std::string NodeManager::flowchart_hash() {
+  std::vector<std::string> parts;
+  for (auto& [name, node] : nodes) {
+    parts.push_back(node->get_register().get_name() + ":" + node->get_type_name() + ":" + name);
+  }
+  for (auto& [out_node, in_node, out_term, in_term] : dump_connections(dump_nodes())) {
+    parts.push_back(out_node + "." + out_term + ">" + in_node + "." + in_term);
+  }
+  std::sort(parts.begin(), parts.end());
+  // 64 bit FNV-1a, so that the hash is the same across platforms and compilers
+  uint64_t h = 14695981039346656037ull;
+  for (auto& part : parts) {
+    for (unsigned char c : part) {
+      h ^= c;
+      h *= 1099511628211ull;
+    }
+    h ^= '\n';
+    h *= 1099511628211ull;
+  }
+  std::stringstream ss;
+  ss << std::hex << std::setw(16) << std::setfill('0') << h;
+  return ss.str();
+}
+std::string NodeManager::history_key(Node& node) {
+  if (flowchart_hash_.empty())
+    flowchart_hash_ = flowchart_hash();
+  return RunHistory::make_key(flowchart_hash_, node.get_register().get_name() + "." + node.get_type_name(), node.get_name());
+}
+double NodeManager::estimated_critical_path_ms(Node& node) {
+  auto it = critical_path_ms_.find(&node);
+  if (it != critical_path_ms_.end())
+    return it->second;
+
+  double node_ms = 0;
+  if (run_history) {
+    if (auto estimate = run_history->estimate_ms(history_key(node)))
+      node_ms = *estimate;
+  }
+  double longest_child_ms = 0;
+  for (auto& child : node.get_child_nodes()) {
+    longest_child_ms = std::max(longest_child_ms, estimated_critical_path_ms(*child));
+  }
+  return critical_path_ms_[&node] = node_ms + longest_child_ms;
+}
+void NodeManager::update_critical_paths() {
+  critical_path_ms_.clear();
+  if (!run_history) return;
+  for (auto& [name, node] : nodes) {
+    estimated_critical_path_ms(*node);
+  }
 }
 size_t NodeManager::run_all(bool notify_children) {
+  run_report.clear();
   // disable autorun on nodes that do not have valid parameters
   for (auto& [nname, node] : nodes) {
     for (auto& [name, param] : node->parameters) {
@@ -490,16 +609,28 @@ size_t NodeManager::run_all(bool notify_children) {
       node->notify_children();
     }
   }
-  size_t run_count = 0;
+  // queue all roots at once so that independent chains share the queue and can run at the same time, the root that
+  // heads the longest chain is dispatched first
+  update_critical_paths();
+  decltype(node_queue)().swap(node_queue);
+  setup_process_crs();
   for (auto& node : to_run){
-    run_count += run(node, notify_children);
+    node->update_status();
+    node->queue();
   }
-  return run_count;
+  return process_queued_nodes();
 }
 size_t NodeManager::run(Node &node, bool notify_children) {
-  std::queue<std::shared_ptr<Node>>().swap(node_queue); // clear to prevent double processing of nodes ()
+  run_report.clear();
+  update_critical_paths();
+  decltype(node_queue)().swap(node_queue); // clear to prevent double processing of nodes ()
   node.update_status();
-  size_t run_count = 0;
+  setup_process_crs();
+  if (!node.queue()) return 0;
+  if (notify_children) node.notify_children();
+  return process_queued_nodes();
+}
+void NodeManager::setup_process_crs() {
   if(global_flowchart_params.count("GF_PROCESS_CRS")) {
     auto crsParam =  global_flowchart_params["GF_PROCESS_CRS"].get();
     if( auto* valptr = dynamic_cast<ParameterByValue<std::string>*>(crsParam)) {
@@ -537,34 +668,155 @@ size_t NodeManager::run(Node &node, bool notify_children) {
       }
     }
   }
-  if (node.queue()) {
-    if (notify_children) node.notify_children();
-    while (!node_queue.empty()) {
-      auto n = node_queue.front();
-      node_queue.pop();
-      n->status_ = GF_NODE_PROCESSING;
-      // n->preprocess();
-      std::cout << "P " << n->get_name() << "..." << std::flush;
-      std::clock_t c_start = std::clock(); // CPU time
-      // copy parameter values from master if a master is set
-      for (auto& [name, param] : n->parameters) {
-        param->copy_value_from_master();
-      }
+}
+size_t NodeManager::process_queued_nodes() {
+  if (max_jobs > 1) return process_queue_concurrent();
+  size_t run_count = 0;
+  while (!node_queue.empty()) {
+    auto n = node_queue.top().node;
+    node_queue.pop();
+    n->status_ = GF_NODE_PROCESSING;
+    // n->preprocess();
+    std::cout << "P " << n->get_name() << "..." << std::flush;
+    std::clock_t c_start = std::clock(); // CPU time
+    NodeRunRecord record;
+    record.memory_estimate = n->estimate_memory();
 //      try {
-        n->process();
-        n->status_ = GF_NODE_DONE;
-        ++run_count;
-        n->propagate_outputs();
+      process_node(*n, record);
+      if (run_history) run_history->record(history_key(*n), record.wall_ms);
+      run_report.push_back(record);
+      n->status_ = GF_NODE_DONE;
+      ++run_count;
+      n->propagate_outputs();
 //      } catch (const gfException& e) {
 //        std::cout << "ERROR: gfException -- " << e.what() << "\n" << std::flush;
 //        n->status_ = GF_NODE_READY;
 //      }
-      std::clock_t c_end = std::clock(); // CPU time
-      std::cout << 1000.0 * (c_end-c_start) / CLOCKS_PER_SEC << "ms\n";
+    std::clock_t c_end = std::clock(); // CPU time
+    std::cout << 1000.0 * (c_end-c_start) / CLOCKS_PER_SEC << "ms\n";
+  }
+  return run_count;
+}
+void NodeManager::process_node(Node& node, NodeRunRecord& record) {
+  record.node_name = node.get_name();
+  size_t rss_start = memory_budget ? get_current_rss() : 0;
+  auto t_start = std::chrono::steady_clock::now(); // Wall time
+  // copy parameter values from master if a master is set
+  for (auto& [name, param] : node.parameters) {
+    param->copy_value_from_master();
+  }
+  node.process();
+  std::chrono::duration<double, std::milli> t_run = std::chrono::steady_clock::now() - t_start;
+  record.wall_ms = t_run.count();
+  if (memory_budget)
+    record.process_rss_delta = (long long)get_current_rss() - (long long)rss_start;
+}
+size_t NodeManager::process_queue_concurrent() {
+  // Ready nodes are started on their own thread as long as fewer than max_jobs nodes are running and the sum of
+  // their memory estimates fits in the memory budget. A node that does not fit waits until enough running nodes are
+  // done, nodes behind it in the queue are not started before it. Outputs are propagated on this thread, so the
+  // flowchart itself is only modified from one thread.
+  struct FinishedNode {
+    NodeHandle node;
+    NodeRunRecord record;
+    std::exception_ptr error;
+  };
+  std::mutex finished_mutex;
+  std::condition_variable finished_cv;
+  std::deque<FinishedNode> finished;
+  std::unordered_map<Node*, std::thread> running;
+  size_t running_memory = 0;
+  std::exception_ptr error;
+  size_t run_count = 0;
+
+  while (true) {
+    while (!error && !node_queue.empty() && running.size() < max_jobs) {
+      auto n = node_queue.top().node;
+      NodeRunRecord record;
+      record.memory_estimate = n->estimate_memory();
+      if (memory_budget && !running.empty() && running_memory + record.memory_estimate > memory_budget)
+        break;
+      node_queue.pop();
+      n->status_ = GF_NODE_PROCESSING;
+      running_memory += record.memory_estimate;
+      std::cout << "P " << n->get_name() << "... (" << running.size()+1 << " running)\n" << std::flush;
+      running[n.get()] = std::thread([this, n, record, &finished_mutex, &finished_cv, &finished]() mutable {
+        std::exception_ptr node_error;
+        // PROJ objects and the CRS setup of manager.proj are not shared with the other running nodes
+        proj.use_node_transformer(true);
+        try {
+          process_node(*n, record);
+        } catch (...) {
+          node_error = std::current_exception();
+        }
+        proj.use_node_transformer(false);
+        {
+          std::lock_guard<std::mutex> lock(finished_mutex);
+          finished.push_back({n, record, node_error});
+        }
+        finished_cv.notify_one();
+      });
+    }
+    if (running.empty()) break;
+
+    std::unique_lock<std::mutex> lock(finished_mutex);
+    finished_cv.wait(lock, [&finished]{ return !finished.empty(); });
+    auto f = std::move(finished.front());
+    finished.pop_front();
+    lock.unlock();
+
+    running[f.node.get()].join();
+    running.erase(f.node.get());
+    running_memory -= f.record.memory_estimate;
+    // the data offset may have been set by the node, the globals are only written from this thread
+    proj->publish_data_offset();
+    if (f.error) {
+      // let the running nodes finish, but do not start new ones
+      if (!error) error = f.error;
+      continue;
     }
+    if (run_history) run_history->record(history_key(*f.node), f.record.wall_ms);
+    run_report.push_back(f.record);
+    f.node->status_ = GF_NODE_DONE;
+    ++run_count;
+    std::cout << "D " << f.record.node_name << " " << f.record.wall_ms << "ms\n";
+    f.node->propagate_outputs();
   }
+  if (error) std::rethrow_exception(error);
   return run_count;
 }
+void NodeManager::print_run_report(std::ostream& os) {
+  const double MB = 1024.0 * 1024.0;
+  os << "Run report (" << max_jobs << " jobs";
+  if (memory_budget) os << ", memory budget " << std::fixed << std::setprecision(0) << memory_budget / MB << " MB";
+  os << ")\n";
+  os << "  " << std::left << std::setw(32) << "node" << std::right
+     << std::setw(12) << "wall ms" << std::setw(14) << "estimate MB" << std::setw(22) << "process RSS delta MB" << "\n";
+  os << std::fixed << std::setprecision(1);
+  for (auto& record : run_report) {
+    os << "  " << std::left << std::setw(32) << record.node_name << std::right
+       << std::setw(12) << record.wall_ms
+       << std::setw(14);
+    if (record.memory_estimate)
+      os << record.memory_estimate / MB;
+    else
+      os << "-";
+    os << std::setw(22);
+    if (record.process_rss_delta)
+      os << *record.process_rss_delta / MB << "\n";
+    else
+      os << "-" << "\n";
+  }
+  auto proj_stats = getProjObjectStats();
+  os << "PROJ objects created: " << proj_stats.crs_created << " CRS, " << proj_stats.transformations_created
+     << " transformations, " << proj_stats.cache_hits << " reused from cache\n";
+  auto grid_stats = getProjGridCacheStats();
+  if (grid_stats.files) {
+    os << "PROJ grid cache: " << grid_stats.files << " files (" << std::fixed << std::setprecision(1) << grid_stats.bytes / MB
+       << " MB), " << grid_stats.hits << " opens from memory, " << grid_stats.misses << " from disk\n";
+  }
+  os << std::defaultfloat;
+}
 NodeHandle NodeManager::create_node(NodeRegisterHandle node_register, std::string type_name) {
   // add node through a node register
   std::string new_name = type_name + "-" + random_string(6);
@@ -574,6 +826,7 @@ NodeHandle NodeManager::create_node(NodeRegisterHandle node_register, std::strin
     *this
   );
   nodes[new_name] = handle;
+  invalidate_flowchart_hash();
   return handle;
 }
 NodeHandle NodeManager::create_node(NodeRegisterHandle node_register, std::string type_name, std::pair<float,float> pos) {
@@ -583,10 +836,12 @@ NodeHandle NodeManager::create_node(NodeRegisterHandle node_register, std::strin
 }
 void NodeManager::remove_node(NodeHandle node) {
   nodes.erase(node->get_name());
+  invalidate_flowchart_hash();
 }
 void NodeManager::clear() {
   flowchart_path.clear();
   nodes.clear();
+  invalidate_flowchart_hash();
   proj->proj_clear();
   global_flowchart_params.clear();
 }
@@ -808,45 +1063,16 @@ std::vector<NodeHandle> NodeManager::load_json(std::string filepath, bool strict
 
 
 std::string NodeManager::substitute_globals(const std::string& textt) const {
-  size_t start_pos=0;
-  std::string text(textt);
-  while(true) {
-    auto open = text.find("{{", start_pos);
-    if (open==std::string::npos) break;
-
-    auto close = text.find("}}", start_pos);
-    if (close==std::string::npos) break;
-    open+=2;
-    auto len = close-open;
-    std::string global_name = text.substr(open, len);
-    if (global_flowchart_params.find(global_name) != global_flowchart_params.end()) {
-      if(global_flowchart_params.at(global_name)->is_type(typeid(std::string))) {
-        auto* global_val = static_cast<ParameterByValue<std::string>*>(global_flowchart_params.at(global_name).get());
-        text.replace(open-2, len+4, global_val->get());
-      } else if(global_flowchart_params.at(global_name)->is_type(typeid(int))) {
-        auto* global_val = static_cast<ParameterByValue<int>*>(global_flowchart_params.at(global_name).get());
-        text.replace(open-2, len+4, std::to_string(global_val->get()));
-      } else if(global_flowchart_params.at(global_name)->is_type(typeid(float))) {
-        auto* global_val = static_cast<ParameterByValue<float>*>(global_flowchart_params.at(global_name).get());
-        text.replace(open-2, len+4, std::to_string(global_val->get()));
-      } else if(global_flowchart_params.at(global_name)->is_type(typeid(bool))) {
-        auto* global_val = static_cast<ParameterByValue<bool>*>(global_flowchart_params.at(global_name).get());
-        if (global_val->get())
-          text.replace(open-2, len+4, "true");
-        else
-          text.replace(open-2, len+4, "false");
-      } else {
-        // throw warning that subtitute param is not found
-        start_pos = close;
-        throw gfException("subtitute param is not found");
-      }
-    }  else {
-      // throw warning that subtitute param is not subtituted
-      start_pos = close;
-      throw gfException("subtitute param is not subtituted: " + global_name);
-    }
+  std::lock_guard<std::mutex> lock(global_templates_mutex_);
+  if (global_templates_.size() > max_cached_templates) global_templates_.clear();
+  auto& text = global_templates_[textt];
+  if (!text) {
+    text = std::make_shared<StringTemplate>(textt);
+    text->bind_globals(*this);
+  } else if (!text->globals_are_bound_to(*this)) {
+    text->bind_globals(*this);
   }
-  return text;
+  return text->render();
 }
 // void NodeManager::set_process_crs(const char* crs) {
 //   // https://proj.org/development/reference/functions.html#c.proj_create
@@ -29,6 +29,8 @@
 #include <unordered_set>
 #include <set>
 #include <queue>
+#include <atomic>
+#include <mutex>
 #include <typeinfo>
 #include <typeindex>
 
@@ -49,8 +51,10 @@
 
 #include "common.hpp"
 #include "parameters.hpp"
+#include "selection.hpp"
 
 #include "projHelper.hpp"
+#include "run_history.hpp"
 
 namespace geoflow {
 
@@ -121,6 +125,7 @@ namespace geoflow {
 
   class Node;
   class NodeManager;
+  class StringTemplate;
   class NodeRegister;
   typedef std::shared_ptr<NodeRegister> NodeRegisterHandle;
   // typedef std::weak_ptr<InputTerminal> InputHandle;
@@ -131,6 +136,8 @@ namespace geoflow {
   
   class gfOutputTerminal;
   class gfSingleFeatureOutputTerminal;
+  template<typename T> class OutputHandle;
+  template<typename T> class VectorOutput;
 
   enum gfIO {GF_IN, GF_OUT};
   // enum gfTerminalFamily {GF_UNKNOWN, GF_BASIC, GF_VECTOR, GF_POLY};
@@ -205,6 +212,8 @@ namespace geoflow {
   class gfSingleFeatureInputTerminal : public gfInputTerminal {
     protected:
     std::weak_ptr<gfOutputTerminal> connected_output_;
+    // same terminal as connected_output_, kept so that element access does not need to lock the weak_ptr
+    gfSingleFeatureOutputTerminal* connected_output_ptr_ = nullptr;
     void update_on_receive(bool queue);
     void connect_output(gfOutputTerminal& output_term);
     void disconnect_output(gfOutputTerminal& output_term);
@@ -225,8 +234,12 @@ namespace geoflow {
     // multi element (vector)
     const gfTerminalFamily get_family() { return GF_SINGLE_FEATURE; };
     template<typename T> const T get(size_t i);
+    // element i, read in place also when the connected output is a view (see gfSingleFeatureOutputTerminal::set_view)
+    const std::any& get_any(size_t i) const;
     const std::vector<std::any>& get_data_vec() const;
     size_t size() const;
+    // connected output terminal, nullptr if not connected
+    const gfSingleFeatureOutputTerminal* get_connected_output() const { return connected_output_ptr_; };
 
     friend class gfSingleFeatureOutputTerminal;
   };
@@ -275,7 +288,19 @@ namespace geoflow {
     // private:
     // std::any data_;
     private:
-    std::vector<std::any> data_;
+    // mutable so that a view can copy its rows on the first get_data_vec()
+    mutable std::vector<std::any> data_;
+    // set when this terminal is a view on selected rows of another terminal, see set_view()
+    std::shared_ptr<const gfSingleFeatureOutputTerminal> view_source_;
+    Selection view_selection_;
+    mutable std::atomic<bool> view_copied_{false};
+    mutable std::mutex view_mutex_;
+    // copy the rows of a view into data_, they stay readable through the view
+    void copy_view() const;
+    // turn a view into a terminal that owns its rows, before data_ is modified
+    void own_data();
+    // drop a view without copying its rows, before data_ is replaced
+    void reset_view();
     
     protected:
     // void clear();
@@ -289,51 +314,73 @@ namespace geoflow {
     const gfTerminalFamily get_family() { return GF_SINGLE_FEATURE; };
     bool has_data() const;
     void push_back_any(const std::any& data) {
+      own_data();
       data_.push_back(data);
     }
     template<typename T> void push_back(T data) {
       if(!accepts_type(typeid(T)))
         throw gfException("illegal type for gfSingleFeatureOutputTerminal (" + get_full_name() + ")");
+      own_data();
       data_.push_back(std::move(data));
       touch();
     };
     template<typename T> T& set(T data){
       if(!accepts_type(typeid(T)))
         throw gfException("illegal type for gfSingleFeatureOutputTerminal (" + get_full_name() + ")");
+      reset_view();
       data_.clear();
       push_back(data);
       return std::any_cast<T&>(data_[0]);
     };
     void set_from_any(const std::any& data) {
+      reset_view();
       data_.clear();
       data_.resize(1);
       data_[0] = data;
       touch();
     }
     void operator=(const std::vector<std::any>& data_vec) {
+      reset_view();
       data_.clear();
       data_ = data_vec;
       touch();
     }
+    // Make this terminal a view on the rows of source picked by selection, without copying them. size(), get_any()
+    // and get<T>() read the rows of source in place, get_data_vec() copies them once for readers that need contiguous
+    // data. A view of a view selects from the original source. The view holds on to source until it is cleared.
+    void set_view(const gfSingleFeatureOutputTerminal& source, const Selection& selection);
+    bool is_view() const { return view_source_ != nullptr; };
 
     bool has_value(size_t i=0) {
-      return !data_[i].has_value();
+      return !get_any(i).has_value();
     }
 
     // multi element
-    size_t size() const { return data_.size(); };
+    size_t size() const { return view_source_ ? view_selection_.size() : data_.size(); };
     template<typename T>void resize(size_t n) {
+      own_data();
       return data_.resize(n, T());
     };
-    std::any& get_data() { return data_[0]; };
-    const std::any& get_data() const { return data_[0]; };
-    std::vector<std::any>& get_data_vec() { return data_; };
-    const std::vector<std::any>& get_data_vec() const { return data_; };
+    const std::any& get_any(size_t i) const {
+      return view_source_ ? view_source_->get_any(view_selection_[i]) : data_[i];
+    };
+    // readers that get a non-const reference (eg. get<T&>() on an input) can modify the rows of the source of a view,
+    // just like the rows of a terminal that owns its data
+    std::any& get_any(size_t i) {
+      return const_cast<std::any&>(std::as_const(*this).get_any(i));
+    };
+    std::any& get_data() { own_data(); return data_[0]; };
+    const std::any& get_data() const { return get_any(0); };
+    std::vector<std::any>& get_data_vec() { own_data(); return data_; };
+    const std::vector<std::any>& get_data_vec() const {
+      if (view_source_ && !view_copied_) copy_view();
+      return data_;
+    };
     template<typename T> T get(size_t i) { 
-      return std::any_cast<T>(data_[i]); 
+      return std::any_cast<T>(get_any(i)); 
     };
     template<typename T> const T get(size_t i) const { 
-      return std::any_cast<T>(data_[i]); 
+      return std::any_cast<T>(get_any(i)); 
     };
     template<typename T> T get() { 
       return get<T>(0); 
@@ -345,12 +392,12 @@ namespace geoflow {
 
     friend class gfSingleFeatureInputTerminal;
     friend class gfMultiFeatureOutputTerminal;
+    template<typename T> friend class OutputHandle;
+    template<typename T> friend class VectorOutput;
   };
 
   template<typename T>const T gfSingleFeatureInputTerminal::get(size_t i) {
-    auto output_term = connected_output_.lock();
-    auto sot = (gfSingleFeatureOutputTerminal*)(output_term.get());
-    return sot->get<T>(i);
+    return std::any_cast<T>(connected_output_ptr_->get_any(i));
   }
   template<typename T> const T gfSingleFeatureInputTerminal::get() {
     return get<T>(0);
@@ -366,6 +413,7 @@ namespace geoflow {
     // BasicRefs basic_terminals_;
     // VectorRefs vector_terminals_;
     SubTermRefs sub_terminals_;
+    size_t sub_terminals_version_ = 0;
     void push_term_ref(gfOutputTerminal* term_ptr);
     void rebuild_terminal_refs();
 
@@ -388,6 +436,8 @@ namespace geoflow {
     size_t size() const;
 
     const SubTermRefs& sub_terminals() { return sub_terminals_; };
+    // changes whenever sub_terminals() is rebuilt, so that pointers to sub terminals can be kept until then
+    size_t sub_terminals_version() const { return sub_terminals_version_; };
     // const BasicRefs& basic_terminals() { return basic_terminals_; };
     // const VectorRefs& vector_terminals() { return vector_terminals_; };
   };
@@ -457,9 +507,65 @@ namespace geoflow {
     static const gfTerminalFamily value = GF_MULTI_FEATURE;
   };
 
+  // Typed handles to terminals, returned by the templated Node::add_input<T>(), add_output<T>() etc. They are meant to be
+  // stored as node members and used in process(), so that no terminal lookup by name is needed. The value type is fixed
+  // at compile time and the terminal only accepts connections that provide that type.
+  template<typename T> class InputHandle {
+    gfSingleFeatureInputTerminal* term_ = nullptr;
+
+    public:
+    InputHandle() {};
+    InputHandle(gfSingleFeatureInputTerminal& term) : term_(&term) {};
+
+    gfSingleFeatureInputTerminal& terminal() const { return *term_; };
+    bool has_data() const { return term_->has_data(); };
+    // an unconnected (optional) input has size 0, element access on it throws gfIOError
+    size_t size() const { return term_->size(); };
+    const T& get(size_t i=0) const {
+      return std::any_cast<const T&>(term_->get_any(i));
+    };
+    const T& operator[](size_t i) const { return get(i); };
+  };
+  template<typename T> class OutputHandle {
+    gfSingleFeatureOutputTerminal* term_ = nullptr;
+
+    public:
+    OutputHandle() {};
+    OutputHandle(gfSingleFeatureOutputTerminal& term) : term_(&term) {};
+
+    gfSingleFeatureOutputTerminal& terminal() const { return *term_; };
+    bool has_data() const { return term_->has_data(); };
+    T& set(T value) {
+      term_->reset_view();
+      term_->data_.clear();
+      term_->data_.emplace_back(std::move(value));
+      term_->touch();
+      return std::any_cast<T&>(term_->data_[0]);
+    };
+    T& get() { return std::any_cast<T&>(term_->get_data()); };
+  };
+  template<typename T> class VectorOutput {
+    gfSingleFeatureOutputTerminal* term_ = nullptr;
+
+    public:
+    VectorOutput() {};
+    VectorOutput(gfSingleFeatureOutputTerminal& term) : term_(&term) {};
+
+    gfSingleFeatureOutputTerminal& terminal() const { return *term_; };
+    bool has_data() const { return term_->has_data(); };
+    size_t size() const { return term_->size(); };
+    void reserve(size_t n) { term_->own_data(); term_->data_.reserve(n); };
+    void push_back(T value) {
+      term_->own_data();
+      term_->data_.emplace_back(std::move(value));
+      term_->touch();
+    };
+    T& operator[](size_t i) { return std::any_cast<T&>(term_->get_data_vec()[i]); };
+  };
+
   class Node : public std::enable_shared_from_this<Node>, public gfObject {
     private:
-    template<typename T> T& add_input(std::string name, std::initializer_list<std::type_index> types, bool is_optional, bool supports_multiple_elements) {
+    template<typename T> T& add_input_terminal(std::string name, std::initializer_list<std::type_index> types, bool is_optional, bool supports_multiple_elements) {
       // TODO: check if name is unique key in input_terminals map
       auto term_handle = std::make_shared<T>(
         *this, name, types, is_optional, supports_multiple_elements
@@ -467,7 +573,7 @@ namespace geoflow {
       input_terminals[name] = term_handle;
       return *term_handle;
     }
-    template<typename T> T& add_output(std::string name, std::initializer_list<std::type_index> types, bool supports_multiple_elements) {
+    template<typename T> T& add_output_terminal(std::string name, std::initializer_list<std::type_index> types, bool supports_multiple_elements) {
       // TODO: check if name is unique key in output_terminals map
       auto term_handle  = std::make_shared<T>(
         *this, name, types, supports_multiple_elements
@@ -475,7 +581,7 @@ namespace geoflow {
       output_terminals[name]= term_handle;
       return *term_handle;
     }
-    template<typename T> T& add_input(std::string name, const std::vector<std::type_index> types, bool is_optional, bool supports_multiple_elements) {
+    template<typename T> T& add_input_terminal(std::string name, const std::vector<std::type_index> types, bool is_optional, bool supports_multiple_elements) {
       // TODO: check if name is unique key in input_terminals map
       auto term_handle = std::make_shared<T>(
         *this, name, types, is_optional, supports_multiple_elements
@@ -483,7 +589,7 @@ namespace geoflow {
       input_terminals[name] = term_handle;
       return *term_handle;
     }
-    template<typename T> T& add_output(std::string name, const std::vector<std::type_index> types, bool supports_multiple_elements) {
+    template<typename T> T& add_output_terminal(std::string name, const std::vector<std::type_index> types, bool supports_multiple_elements) {
       // TODO: check if name is unique key in output_terminals map
       auto term_handle  = std::make_shared<T>(
         *this, name, types, supports_multiple_elements
@@ -564,47 +670,62 @@ namespace geoflow {
       }
     }
 
-    gfNodeStatus status_ = GF_NODE_WAITING;
+    // atomic because it is read from other nodes' threads while nodes are processed concurrently
+    std::atomic<gfNodeStatus> status_{GF_NODE_WAITING};
 
     gfSingleFeatureInputTerminal& add_input(std::string name, std::type_index type, bool is_optional=false) {
-      return add_input<gfSingleFeatureInputTerminal>(name, {type}, is_optional, false);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, {type}, is_optional, false);
     };
     gfSingleFeatureInputTerminal& add_input(std::string name, std::initializer_list<std::type_index> types, bool is_optional=false) {
-      return add_input<gfSingleFeatureInputTerminal>(name, types, is_optional, false);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, types, is_optional, false);
     };
     gfSingleFeatureInputTerminal& add_input(std::string name, std::vector<std::type_index> types, bool is_optional=false) {
-      return add_input<gfSingleFeatureInputTerminal>(name, types, is_optional, false);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, types, is_optional, false);
     };
     gfSingleFeatureInputTerminal& add_vector_input(std::string name, std::type_index type, bool is_optional=false){
-      return add_input<gfSingleFeatureInputTerminal>(name, {type}, is_optional, true);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, {type}, is_optional, true);
     };
     gfSingleFeatureInputTerminal& add_vector_input(std::string name, std::initializer_list<std::type_index> types, bool is_optional=false) {
-      return add_input<gfSingleFeatureInputTerminal>(name, types, is_optional, true);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, types, is_optional, true);
     };
     gfSingleFeatureInputTerminal& add_vector_input(std::string name, std::vector<std::type_index> types, bool is_optional=false) {
-      return add_input<gfSingleFeatureInputTerminal>(name, types, is_optional, true);
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, types, is_optional, true);
     };
     gfMultiFeatureInputTerminal& add_poly_input(std::string name, std::initializer_list<std::type_index> types, bool is_optional=false) {
-      return add_input<gfMultiFeatureInputTerminal>(name, types, is_optional, true);
+      return add_input_terminal<gfMultiFeatureInputTerminal>(name, types, is_optional, true);
     };
     gfMultiFeatureInputTerminal& add_poly_input(std::string name, std::vector<std::type_index> types, bool is_optional=false) {
-      return add_input<gfMultiFeatureInputTerminal>(name, types, is_optional, true);
+      return add_input_terminal<gfMultiFeatureInputTerminal>(name, types, is_optional, true);
     };
 
     gfSingleFeatureOutputTerminal& add_output(std::string name, std::type_index type) {
-      return add_output<gfSingleFeatureOutputTerminal>(name, {type}, false);
+      return add_output_terminal<gfSingleFeatureOutputTerminal>(name, {type}, false);
     };
     gfSingleFeatureOutputTerminal& add_output(std::string name, const std::vector<std::type_index> types) {
-      return add_output<gfSingleFeatureOutputTerminal>(name, types, false);
+      return add_output_terminal<gfSingleFeatureOutputTerminal>(name, types, false);
     };
     gfSingleFeatureOutputTerminal& add_vector_output(std::string name, std::type_index type) {
-      return add_output<gfSingleFeatureOutputTerminal>(name, {type}, true);
+      return add_output_terminal<gfSingleFeatureOutputTerminal>(name, {type}, true);
     };
     gfMultiFeatureOutputTerminal& add_poly_output(std::string name, std::initializer_list<std::type_index> types) {
-      return add_output<gfMultiFeatureOutputTerminal>(name, types, true);
+      return add_output_terminal<gfMultiFeatureOutputTerminal>(name, types, true);
     };
     gfMultiFeatureOutputTerminal& add_poly_output(std::string name, std::vector<std::type_index> types) {
-      return add_output<gfMultiFeatureOutputTerminal>(name, types, true);
+      return add_output_terminal<gfMultiFeatureOutputTerminal>(name, types, true);
+    };
+
+    // typed terminals, eg. `InputHandle<vec1f> heights = add_vector_input<vec1f>("heights");`
+    template<typename T> InputHandle<T> add_input(std::string name, bool is_optional=false) {
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, {typeid(T)}, is_optional, false);
+    };
+    template<typename T> InputHandle<T> add_vector_input(std::string name, bool is_optional=false) {
+      return add_input_terminal<gfSingleFeatureInputTerminal>(name, {typeid(T)}, is_optional, true);
+    };
+    template<typename T> OutputHandle<T> add_output(std::string name) {
+      return add_output_terminal<gfSingleFeatureOutputTerminal>(name, {typeid(T)}, false);
+    };
+    template<typename T> VectorOutput<T> add_vector_output(std::string name) {
+      return add_output_terminal<gfSingleFeatureOutputTerminal>(name, {typeid(T)}, true);
     };
 
     std::set<NodeHandle> get_child_nodes();
@@ -615,6 +736,8 @@ namespace geoflow {
     // void set_param(std::string name, Parameter param, bool quiet=false);
     // void set_params(ParameterMap param_map, bool quiet=false);
     const ParameterMap&  dump_params();
+    // sum of the versions of all parameters, it only changes when a parameter value changed (see Parameter::get_version)
+    size_t parameters_version() const;
 
     void set_position(float x, float y) {
       position[0]=x;
@@ -660,21 +783,41 @@ namespace geoflow {
     virtual void on_change_parameter(std::string name, Parameter& param){};
     virtual void before_gui(){};
     virtual std::string info() {return std::string();};
+    // estimated peak memory use of process() in bytes, 0 if unknown. Used by the NodeManager to limit the
+    // nodes that run concurrently to its memory budget. Override to estimate from the input sizes.
+    virtual size_t estimate_memory() { return memory_estimate_; };
+    // nodes that run a nested flowchart expose (a copy of) it, so that it can be included in an execution plan
+    virtual std::shared_ptr<NodeManager> get_nested_flowchart() { return nullptr; };
+    // number of times the nested flowchart will run, if that is known before processing
+    virtual std::optional<size_t> get_nested_item_count() { return std::nullopt; };
 
     std::string debug_info();
     const std::string get_type_name() { return type_name; };
     const NodeRegister& get_register() { return *node_register; };
     const NodeManager& get_manager() { return manager; };
     
+    // text with the [[attribute]] placeholders replaced by the values of feature i on term. The parsed text is cached
+    // per node, so calling this for every feature only renders the bound values
     std::string substitute_from_term(const std::string& textt, gfMultiFeatureInputTerminal& term, const size_t& i=0);
 
     protected:
     void set_name(std::string new_name);
+    // fixed memory estimate in bytes, for nodes whose memory use does not depend on their inputs
+    void set_memory_estimate(size_t bytes) { memory_estimate_ = bytes; };
+    size_t memory_estimate_ = 0;
+    // templates used by substitute_from_term, by text. Rebound when the sub terminals of term change
+    struct AttributeTemplate {
+      std::shared_ptr<StringTemplate> text;
+      const gfMultiFeatureInputTerminal* term = nullptr;
+      size_t term_version = 0;
+    };
+    std::unordered_map<std::string, AttributeTemplate> attribute_templates_;
     const std::string type_name; // to be managed only by node manager because uniqueness constraint (among all nodes in the manager)
     NodeManager& manager;
     NodeRegisterHandle node_register;
 
     friend class NodeManager;
+    friend class gfOutputTerminal;
   };
 
   class NodeRegister : public std::enable_shared_from_this<NodeRegister> {
@@ -741,7 +884,24 @@ namespace geoflow {
 
     public:
     std::map<std::string, std::shared_ptr<Parameter>> global_flowchart_params;
-    std::unique_ptr<projHelperInterface> proj;
+    ProjHelperHandle proj;
+    // optional runtime statistics from previous runs, used to prioritise nodes on the critical path
+    std::shared_ptr<RunHistory> run_history;
+    // maximum number of nodes that are processed at the same time
+    size_t max_jobs = 1;
+    // maximum sum of the memory estimates of the nodes that are processed at the same time in bytes, 0 for no limit
+    size_t memory_budget = 0;
+
+    struct NodeRunRecord {
+      std::string node_name;
+      double wall_ms = 0;
+      size_t memory_estimate = 0;
+      // change in resident set size of the whole process while the node was running, so it includes nodes that ran at
+      // the same time. Only sampled when a memory budget is set
+      std::optional<long long> process_rss_delta;
+    };
+    // nodes processed in the last run, in order of completion
+    std::vector<NodeRunRecord> run_report;
     
     // std::optional<std::array<double,3>> data_offset;
     
@@ -758,8 +918,9 @@ namespace geoflow {
         other_node_manager.json_serialise(ss);
         set_globals(other_node_manager);
         json_unserialise(ss);
+        run_history = other_node_manager.run_history;
         proj = createProjHelper(*this);
-        proj->proj_clone_from(*proj);
+        proj->proj_clone_from(*other_node_manager.proj);
         // data_offset = *other_node_manager.data_offset;
         // projContext = proj_context_clone(other_node_manager.projContext);
         // processCRS = proj_clone(projContext, other_node_manager.processCRS);
@@ -796,6 +957,12 @@ namespace geoflow {
     arr3d coord_transform_rev(const arr3f& p) {
       return proj->coord_transform_rev(p);
     };
+    void coord_transform_fwd(double* coords, size_t n, size_t stride, arr3f* result) {
+      proj->coord_transform_fwd(coords, n, stride, result);
+    };
+    void coord_transform_rev(const arr3f* points, size_t n, double* coords, size_t stride) {
+      proj->coord_transform_rev(points, n, coords, stride);
+    };
 
     void set_process_crs(const char* crs) {
       proj->set_process_crs(crs);
@@ -843,17 +1010,55 @@ namespace geoflow {
 
     void set_globals(const NodeManager& other_manager);
 
+    // text with the {{global}} placeholders replaced by the global flowchart parameters. The parsed text is cached
+    // and rebound when global_flowchart_params no longer holds the parameters it was bound to
     std::string substitute_globals(const std::string& text) const;
+
+    // hash over node types, names and connections. Does not depend on parameter values or node positions
+    std::string flowchart_hash();
+    // forget the cached flowchart hash, called when nodes or connections are added, removed or renamed
+    void invalidate_flowchart_hash() { flowchart_hash_.clear(); };
+    // key of a node in the run history
+    std::string history_key(Node& node);
+    // estimated time from the start of node until all of its descendants are done, based on the run history
+    double estimated_critical_path_ms(Node& node);
+    // recompute the estimates after the flowchart or the run history has changed
+    void update_critical_paths();
     
     size_t run_all(bool notify_children=true);
     size_t run(Node &node, bool notify_children=true);
+    void print_run_report(std::ostream& os);
     size_t run(NodeHandle node, bool notify_children=true) {
       return run(*node, notify_children);
     };
     
     protected:
-    std::queue<NodeHandle> node_queue;
+    // ready nodes are dispatched longest estimated critical path first, ties in the order they were queued
+    struct QueuedNode {
+      double priority;
+      size_t seq;
+      NodeHandle node;
+    };
+    struct QueuedNodeCompare {
+      bool operator()(const QueuedNode& a, const QueuedNode& b) const {
+        if (a.priority != b.priority) return a.priority < b.priority;
+        return a.seq > b.seq;
+      }
+    };
+    std::priority_queue<QueuedNode, std::vector<QueuedNode>, QueuedNodeCompare> node_queue;
+    size_t queue_seq_ = 0;
+    std::string flowchart_hash_;
+    std::unordered_map<Node*, double> critical_path_ms_;
+    // templates used by substitute_globals, by text. Nodes that run at the same time share them
+    mutable std::unordered_map<std::string, std::shared_ptr<StringTemplate>> global_templates_;
+    mutable std::mutex global_templates_mutex_;
     void queue(NodeHandle n);
+    // set the process CRS and data offset from the global flowchart parameters, once per run
+    void setup_process_crs();
+    // process the queued nodes and the children they make ready, serially or concurrently depending on max_jobs
+    size_t process_queued_nodes();
+    size_t process_queue_concurrent();
+    void process_node(Node& node, NodeRunRecord& record);
     
     friend class Node;
   };
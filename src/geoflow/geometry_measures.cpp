@@ -0,0 +1,137 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+
+#include "geometry_measures.hpp"
+#include "parallel.hpp"
+
+namespace geoflow {
+
+  void PolygonMeasures::resize(size_t n) {
+    area.resize(n);
+    perimeter.resize(n);
+    centroid_x.resize(n);
+    centroid_y.resize(n);
+    is_ccw.resize(n);
+    vertex_count.resize(n);
+  }
+
+  struct RingSums {
+    // twice the signed area
+    float area2 = 0;
+    float perimeter = 0;
+    // centroid, only meaningful if area2 != 0
+    float cx = 0;
+    float cy = 0;
+  };
+
+  // Shoelace sums of a ring. Coordinates are taken relative to the first vertex to limit cancellation, and the edges
+  // are spread over 4 independent accumulators so that the loop is not bound by the latency of a single sum.
+  static RingSums ring_sums(const arr3f* ring, size_t n) {
+    RingSums result;
+    if (n < 2) return result;
+    const float ox = ring[0][0], oy = ring[0][1];
+    float a[4] = {0, 0, 0, 0}, p[4] = {0, 0, 0, 0}, sx[4] = {0, 0, 0, 0}, sy[4] = {0, 0, 0, 0};
+    auto edge = [&](size_t k, const arr3f& u, const arr3f& v) {
+      float x0 = u[0] - ox, y0 = u[1] - oy, x1 = v[0] - ox, y1 = v[1] - oy;
+      float cross = x0*y1 - x1*y0;
+      a[k] += cross;
+      sx[k] += (x0 + x1) * cross;
+      sy[k] += (y0 + y1) * cross;
+      p[k] += std::sqrt((x1 - x0)*(x1 - x0) + (y1 - y0)*(y1 - y0));
+    };
+    size_t i = 0;
+    for (; i + 4 < n; i += 4) {
+      edge(0, ring[i], ring[i+1]);
+      edge(1, ring[i+1], ring[i+2]);
+      edge(2, ring[i+2], ring[i+3]);
+      edge(3, ring[i+3], ring[i+4]);
+    }
+    for (; i + 1 < n; ++i) edge(0, ring[i], ring[i+1]);
+    // closing edge
+    edge(0, ring[n-1], ring[0]);
+
+    result.area2 = (a[0] + a[1]) + (a[2] + a[3]);
+    result.perimeter = (p[0] + p[1]) + (p[2] + p[3]);
+    if (result.area2 != 0) {
+      result.cx = ((sx[0] + sx[1]) + (sx[2] + sx[3])) / (3 * result.area2) + ox;
+      result.cy = ((sy[0] + sy[1]) + (sy[2] + sy[3])) / (3 * result.area2) + oy;
+    }
+    return result;
+  }
+
+  // ring(i, j) gives the vertex pointer and size of ring j of polygon i, ring 0 being the exterior ring
+  template <typename RingAccess, typename RingCount> static PolygonMeasures compute_measures(size_t n_polygons, RingAccess ring, RingCount ring_count) {
+    PolygonMeasures m;
+    m.resize(n_polygons);
+    // vector<bool> elements share bytes, so the orientation is written to is_ccw after the parallel loop
+    std::vector<char> is_ccw(n_polygons);
+    parallel_for(n_polygons, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        auto [exterior, n_exterior] = ring(i, 0);
+        auto sums = ring_sums(exterior, n_exterior);
+        is_ccw[i] = sums.area2 > 0;
+        float area = std::abs(sums.area2) / 2;
+        float mx = sums.cx * area, my = sums.cy * area;
+        float perimeter = sums.perimeter;
+        size_t vertex_count = n_exterior;
+        for (size_t j = 1; j < ring_count(i); ++j) {
+          auto [interior, n_interior] = ring(i, j);
+          auto isums = ring_sums(interior, n_interior);
+          float iarea = std::abs(isums.area2) / 2;
+          area -= iarea;
+          mx -= isums.cx * iarea;
+          my -= isums.cy * iarea;
+          perimeter += isums.perimeter;
+          vertex_count += n_interior;
+        }
+        if (area > 0) {
+          m.centroid_x[i] = mx / area;
+          m.centroid_y[i] = my / area;
+        } else {
+          float cx = 0, cy = 0;
+          for (size_t k = 0; k < n_exterior; ++k) {
+            cx += exterior[k][0];
+            cy += exterior[k][1];
+          }
+          m.centroid_x[i] = n_exterior ? cx / n_exterior : 0;
+          m.centroid_y[i] = n_exterior ? cy / n_exterior : 0;
+        }
+        m.area[i] = std::max(area, 0.f);
+        m.perimeter[i] = perimeter;
+        m.vertex_count[i] = int(vertex_count);
+      }
+    }, 1024);
+    for (size_t i = 0; i < n_polygons; ++i) m.is_ccw[i] = is_ccw[i];
+    return m;
+  }
+
+  PolygonMeasures polygon_measures(const std::vector<const LinearRing*>& polygons) {
+    return compute_measures(polygons.size(), [&](size_t i, size_t j) {
+      const vec3f& r = j == 0 ? *polygons[i] : polygons[i]->interior_rings()[j-1];
+      return std::make_pair(r.data(), r.size());
+    }, [&](size_t i) { return 1 + polygons[i]->interior_rings().size(); });
+  }
+
+  PolygonMeasures polygon_measures(const FlatPolygonCollection& polygons) {
+    return compute_measures(polygons.size(), [&](size_t i, size_t j) {
+      auto r = polygons.ring(i, j);
+      return std::make_pair(r.data(), r.size());
+    }, [&](size_t i) { return polygons.ring_count(i); });
+  }
+}
@@ -0,0 +1,43 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <vector>
+
+#include "common.hpp"
+
+namespace geoflow {
+
+  // Measures of polygons in xy, one element per polygon. Interior rings are subtracted from the area and centroid and
+  // add to the perimeter and vertex count. Polygons without area get the mean of their exterior ring vertices as
+  // centroid.
+  struct PolygonMeasures {
+    vec1f area;
+    vec1f perimeter;
+    vec1f centroid_x;
+    vec1f centroid_y;
+    // orientation of the exterior ring
+    vec1b is_ccw;
+    vec1i vertex_count;
+
+    void resize(size_t n);
+  };
+
+  // computed in parallel over the polygons
+  PolygonMeasures polygon_measures(const std::vector<const LinearRing*>& polygons);
+  PolygonMeasures polygon_measures(const FlatPolygonCollection& polygons);
+}
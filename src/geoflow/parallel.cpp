@@ -0,0 +1,95 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include <taskflow/taskflow.hpp>
+
+#include "parallel.hpp"
+
+namespace geoflow {
+
+  static std::mutex executor_mutex_;
+  static std::unique_ptr<tf::Executor> executor_;
+  static size_t n_threads_ = 0;
+  static thread_local bool is_executor_thread_ = false;
+
+  static tf::Executor& executor() {
+    std::lock_guard<std::mutex> lock(executor_mutex_);
+    if (!executor_) {
+      executor_ = std::make_unique<tf::Executor>(get_concurrency());
+    }
+    return *executor_;
+  }
+
+  size_t get_concurrency() {
+    if (n_threads_ == 0) {
+      n_threads_ = std::max(1u, std::thread::hardware_concurrency());
+    }
+    return n_threads_;
+  }
+  void set_concurrency(size_t n_threads) {
+    std::lock_guard<std::mutex> lock(executor_mutex_);
+    if (!executor_ && n_threads > 0) {
+      n_threads_ = n_threads;
+    }
+  }
+  bool is_executor_thread() {
+    return is_executor_thread_;
+  }
+
+  void parallel_invoke(size_t n_tasks, const std::function<void(size_t)>& f) {
+    if (n_tasks == 0) return;
+    if (n_tasks == 1 || is_executor_thread_ || get_concurrency() == 1) {
+      for (size_t i=0; i<n_tasks; ++i) f(i);
+      return;
+    }
+
+    // taskflow does not propagate exceptions, so we catch them in the task and
+    // rethrow the first one on the calling thread
+    std::exception_ptr error;
+    std::mutex error_mutex;
+    tf::Taskflow taskflow;
+    for (size_t i=0; i<n_tasks; ++i) {
+      taskflow.emplace([i, &f, &error, &error_mutex]() {
+        is_executor_thread_ = true;
+        try {
+          f(i);
+        } catch (...) {
+          std::lock_guard<std::mutex> lock(error_mutex);
+          if (!error) error = std::current_exception();
+        }
+      });
+    }
+    executor().run(taskflow).wait();
+    if (error) std::rethrow_exception(error);
+  }
+
+  void parallel_for(size_t n, const std::function<void(size_t, size_t)>& f, size_t grain) {
+    if (n == 0) return;
+    grain = std::max<size_t>(grain, 1);
+    // aim for a few chunks per thread to even out imbalanced ranges
+    size_t chunk = std::max(grain, n / (4 * get_concurrency()) + 1);
+    size_t n_chunks = (n + chunk - 1) / chunk;
+    parallel_invoke(n_chunks, [&](size_t c) {
+      f(c * chunk, std::min(n, (c + 1) * chunk));
+    });
+  }
+}
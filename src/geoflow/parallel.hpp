@@ -0,0 +1,66 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+namespace geoflow {
+
+  // Process wide executor that is shared by everything in geoflow that wants to
+  // run work on multiple threads. Calls block until all work is done. When they
+  // are made from one of the executor's own workers the work is executed inline
+  // on the calling thread, so nesting does not deadlock the executor.
+
+  // Number of worker threads. Defaults to the hardware concurrency.
+  size_t get_concurrency();
+  // Set the number of worker threads. Only has effect before the first use of the executor.
+  void set_concurrency(size_t n_threads);
+  // true if the calling thread is a worker of the shared executor
+  bool is_executor_thread();
+
+  // Call f(begin, end) for consecutive ranges that together cover [0, n). Each
+  // range holds at least grain elements (except possibly the last).
+  void parallel_for(size_t n, const std::function<void(size_t, size_t)>& f, size_t grain=1);
+  // Call f(i) for i in [0, n_tasks), every call as a separate task.
+  void parallel_invoke(size_t n_tasks, const std::function<void(size_t)>& f);
+
+  // Sort [first, last) with comp. The range is split in chunks of at least grain elements that are sorted as separate
+  // tasks and then merged pairwise, again in parallel. Not stable.
+  template <typename RandomIt, typename Compare>
+  void parallel_sort(RandomIt first, RandomIt last, Compare comp, size_t grain=1<<16) {
+    size_t n = size_t(last - first);
+    size_t n_chunks = std::min(get_concurrency(), n / std::max(grain, size_t(1)));
+    if (n_chunks <= 1) {
+      std::sort(first, last, comp);
+      return;
+    }
+    std::vector<size_t> bounds(n_chunks + 1);
+    for (size_t i = 0; i <= n_chunks; ++i) bounds[i] = n * i / n_chunks;
+    parallel_invoke(n_chunks, [&](size_t i) {
+      std::sort(first + bounds[i], first + bounds[i+1], comp);
+    });
+    for (size_t width = 1; width < n_chunks; width *= 2) {
+      parallel_invoke((n_chunks + 2*width - 1) / (2*width), [&](size_t m) {
+        size_t lo = 2*width*m, mid = std::min(lo + width, n_chunks), hi = std::min(lo + 2*width, n_chunks);
+        if (mid < hi) std::inplace_merge(first + bounds[lo], first + bounds[mid], first + bounds[hi], comp);
+      });
+    }
+  }
+}
@@ -47,9 +47,12 @@ namespace geoflow {
     else
       master_parameter_ = master_parameter;
   };
+  void Parameter::copy_value(const Parameter& source) {
+    from_json(source.as_json());
+  }
   void Parameter::copy_value_from_master() {
-    if(!master_parameter_.expired()) {
-      from_json(master_parameter_.lock()->as_json());
+    if (auto master = master_parameter_.lock()) {
+      copy_value(*master);
     }
   };
   bool Parameter::has_master() const {
@@ -69,12 +72,27 @@ namespace geoflow {
   };
   template <typename T> void ParameterByReference<T>::from_json(const json& json_object) {
     value_ = json_object.get<T>();
+    changed();
   };
   template <typename T> T& ParameterByReference<T>::get() {
     return value_;
   }
   template <typename T> void ParameterByReference<T>::set(T val) {
     value_ = val;
+    changed();
+  }
+  template <typename T> void ParameterByReference<T>::copy_value(const Parameter& source) {
+    // set_master only accepts masters of the same type
+    auto value_ptr = source.get_value_ptr();
+    if (!value_ptr) {
+      Parameter::copy_value(source);
+      return;
+    }
+    auto& value = *static_cast<const T*>(value_ptr);
+    if (!(value_ == value)) {
+      value_ = value;
+      changed();
+    }
   }
 
   template <typename T> ParameterByValue<T>::ParameterByValue(T value, std::string label, std::string help) 
@@ -84,12 +102,27 @@ namespace geoflow {
   };
   template <typename T> void ParameterByValue<T>::from_json(const json& json_object) {
     value_ = json_object.get<T>();
+    changed();
   };
   template <typename T> T& ParameterByValue<T>::get() {
     return value_;
   }
   template <typename T> void ParameterByValue<T>::set(T val) {
     value_ = val;
+    changed();
+  }
+  template <typename T> void ParameterByValue<T>::copy_value(const Parameter& source) {
+    // set_master only accepts masters of the same type
+    auto value_ptr = source.get_value_ptr();
+    if (!value_ptr) {
+      Parameter::copy_value(source);
+      return;
+    }
+    auto& value = *static_cast<const T*>(value_ptr);
+    if (!(value_ == value)) {
+      value_ = value;
+      changed();
+    }
   }
 
   template<typename T> ParameterBounded<T>::ParameterBounded(T& val, T min, T max, std::string label, std::string help) : ParameterByReference<T>(val, label, help), min_(min), max_(max) {};
@@ -48,6 +48,15 @@ namespace geoflow {
     std::string label_, help_;
     std::type_index type_;
     std::weak_ptr<Parameter> master_parameter_;
+    size_t version_ = 0;
+
+    // pointer to the value, which has type type_. nullptr for parameters that do not expose it (eg. subclasses in
+    // plugins written before this existed), their values are copied through json instead
+    virtual const void* get_value_ptr() const { return nullptr; };
+    // copy the value of a parameter of the same type, bumps the version if the value is different. Copies through json
+    // by default
+    virtual void copy_value(const Parameter& source);
+    void changed() { ++version_; };
     public:
     Parameter(std::string label, std::string help, std::type_index ttype=typeid(void));
     std::string get_label();
@@ -60,17 +69,27 @@ namespace geoflow {
     bool is_type(std::type_index type);
     bool is_type_compatible(const Parameter& other_parameter);
     void set_master(std::weak_ptr<Parameter> master_parameter);
+    // direct typed copy from the master, without conversion to json
     void copy_value_from_master();
     bool has_master() const;
     void clear_master();
     std::weak_ptr<Parameter> get_master() const;
     virtual ParamType get_ptype() { return Undefined; };
+    // incremented whenever the value is set through set(), from_json() or copied from a different master value. Changes
+    // made directly through a reference from get() are not counted.
+    size_t get_version() const { return version_; };
+
+    template<typename T> friend class ParameterByReference;
+    template<typename T> friend class ParameterByValue;
   };
 
   template<typename T> class ParameterByReference : public Parameter {
     protected:
     T& value_;
-    
+
+    const void* get_value_ptr() const override { return &value_; };
+    void copy_value(const Parameter& source) override;
+
     public:
     ParameterByReference(T& value, std::string label, std::string help);
 
@@ -83,6 +102,9 @@ namespace geoflow {
     protected:
     T value_;
 
+    const void* get_value_ptr() const override { return &value_; };
+    void copy_value(const Parameter& source) override;
+
     public:
     ParameterByValue(T value, std::string label, std::string help);
 
@@ -0,0 +1,242 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+#ifdef _WIN32
+  #include <fstream>
+  #define fseeko _fseeki64
+  #define ftello _ftelli64
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+#include "projHelper.hpp"
+#include "projGridCache.hpp"
+
+namespace fs = std::filesystem;
+
+namespace geoflow {
+
+  // read-only contents of a grid file, never released because contexts may still read from it
+  struct GridFile {
+    const char* data = nullptr;
+    size_t size = 0;
+  #ifdef _WIN32
+    std::vector<char> buffer;
+  #endif
+  };
+
+  // grid files by file name
+  static std::mutex grid_cache_mutex_;
+  static std::map<std::string, std::shared_ptr<GridFile>> grid_cache_;
+  static std::vector<std::shared_ptr<GridFile>> released_grid_files_;
+  static ProjGridCacheStats grid_cache_stats_;
+
+  static std::shared_ptr<GridFile> load_grid_file(const std::string& filepath) {
+    auto file = std::make_shared<GridFile>();
+  #ifdef _WIN32
+    std::ifstream ifs(filepath, std::ios::binary);
+    if (!ifs) return nullptr;
+    file->buffer.assign(std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>());
+    file->data = file->buffer.data();
+    file->size = file->buffer.size();
+  #else
+    int fd = open(filepath.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+      close(fd);
+      return nullptr;
+    }
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return nullptr;
+    file->data = static_cast<const char*>(data);
+    file->size = st.st_size;
+  #endif
+    return file;
+  }
+
+  void setProjGridCacheFiles(const std::vector<std::string>& filepaths) {
+    std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+    for (auto& [name, file] : grid_cache_) released_grid_files_.push_back(file);
+    grid_cache_.clear();
+    grid_cache_stats_.files = 0;
+    grid_cache_stats_.bytes = 0;
+    for (auto& filepath : filepaths) {
+      auto file = load_grid_file(filepath);
+      if (!file) {
+        std::cerr << "Unable to load grid file " << filepath << " into the PROJ grid cache\n";
+        continue;
+      }
+      grid_cache_[fs::path(filepath).filename().string()] = file;
+      ++grid_cache_stats_.files;
+      grid_cache_stats_.bytes += file->size;
+    }
+  }
+
+  ProjGridCacheStats getProjGridCacheStats() {
+    std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+    return grid_cache_stats_;
+  }
+
+  // the GF_PROJ_GRID_CACHE environment variable is read once, before the first context is installed
+  static void init_from_environment() {
+    static std::once_flag once;
+    std::call_once(once, [] {
+      const char* env_p = std::getenv("GF_PROJ_GRID_CACHE");
+      if (!env_p) return;
+    #ifdef _WIN32
+      const char separator = ';';
+    #else
+      const char separator = ':';
+    #endif
+      std::vector<std::string> filepaths;
+      std::stringstream ss(env_p);
+      std::string filepath;
+      while (std::getline(ss, filepath, separator)) {
+        if (!filepath.empty()) filepaths.push_back(filepath);
+      }
+      setProjGridCacheFiles(filepaths);
+    });
+  }
+
+  static std::shared_ptr<GridFile> find_grid_file(const char* filename) {
+    std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+    auto it = grid_cache_.find(fs::path(filename).filename().string());
+    if (it == grid_cache_.end()) return nullptr;
+    return it->second;
+  }
+
+  // PROJ file API, cached grid files are read from memory and all other files through stdio
+  // https://proj.org/development/reference/functions.html#c.proj_context_set_fileapi
+  struct GridFileHandle {
+    std::shared_ptr<GridFile> file;
+    size_t pos = 0;
+    FILE* fp = nullptr;
+  };
+
+  static PROJ_FILE_HANDLE* grid_open(PJ_CONTEXT*, const char* filename, PROJ_OPEN_ACCESS access, void*) {
+    if (access == PROJ_OPEN_ACCESS_READ_ONLY) {
+      if (auto file = find_grid_file(filename)) {
+        {
+          std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+          ++grid_cache_stats_.hits;
+        }
+        auto handle = new GridFileHandle;
+        handle->file = file;
+        return reinterpret_cast<PROJ_FILE_HANDLE*>(handle);
+      }
+    }
+    const char* mode = access == PROJ_OPEN_ACCESS_READ_ONLY ? "rb" : access == PROJ_OPEN_ACCESS_READ_UPDATE ? "r+b" : "w+b";
+    FILE* fp = std::fopen(filename, mode);
+    if (!fp) return nullptr;
+    {
+      std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+      ++grid_cache_stats_.misses;
+    }
+    auto handle = new GridFileHandle;
+    handle->fp = fp;
+    return reinterpret_cast<PROJ_FILE_HANDLE*>(handle);
+  }
+  static size_t grid_read(PJ_CONTEXT*, PROJ_FILE_HANDLE* h, void* buffer, size_t size, void*) {
+    auto handle = reinterpret_cast<GridFileHandle*>(h);
+    if (handle->fp) return std::fread(buffer, 1, size, handle->fp);
+    if (handle->pos >= handle->file->size) return 0;
+    size_t n = std::min(size, handle->file->size - handle->pos);
+    std::memcpy(buffer, handle->file->data + handle->pos, n);
+    handle->pos += n;
+    return n;
+  }
+  static size_t grid_write(PJ_CONTEXT*, PROJ_FILE_HANDLE* h, const void* buffer, size_t size, void*) {
+    auto handle = reinterpret_cast<GridFileHandle*>(h);
+    if (handle->fp) return std::fwrite(buffer, 1, size, handle->fp);
+    return 0;
+  }
+  static int grid_seek(PJ_CONTEXT*, PROJ_FILE_HANDLE* h, long long offset, int whence, void*) {
+    auto handle = reinterpret_cast<GridFileHandle*>(h);
+    if (handle->fp) return fseeko(handle->fp, offset, whence) == 0;
+    long long base = whence == SEEK_SET ? 0 : whence == SEEK_CUR ? (long long)handle->pos : (long long)handle->file->size;
+    if (base + offset < 0) return false;
+    handle->pos = size_t(base + offset);
+    return true;
+  }
+  static unsigned long long grid_tell(PJ_CONTEXT*, PROJ_FILE_HANDLE* h, void*) {
+    auto handle = reinterpret_cast<GridFileHandle*>(h);
+    if (handle->fp) return ftello(handle->fp);
+    return handle->pos;
+  }
+  static void grid_close(PJ_CONTEXT*, PROJ_FILE_HANDLE* h, void*) {
+    auto handle = reinterpret_cast<GridFileHandle*>(h);
+    if (handle->fp) std::fclose(handle->fp);
+    delete handle;
+  }
+  static int grid_exists(PJ_CONTEXT*, const char* filename, void*) {
+    if (find_grid_file(filename)) return true;
+    std::error_code ec;
+    return fs::exists(filename, ec);
+  }
+  static int grid_mkdir(PJ_CONTEXT*, const char* filename, void*) {
+    std::error_code ec;
+    return fs::create_directory(filename, ec) || fs::is_directory(filename, ec);
+  }
+  static int grid_unlink(PJ_CONTEXT*, const char* filename, void*) {
+    std::error_code ec;
+    return fs::remove(filename, ec);
+  }
+  static int grid_rename(PJ_CONTEXT*, const char* old_path, const char* new_path, void*) {
+    std::error_code ec;
+    fs::rename(old_path, new_path, ec);
+    return !ec;
+  }
+
+  void installProjGridCache(PJ_CONTEXT* ctx) {
+    init_from_environment();
+    {
+      std::lock_guard<std::mutex> lock(grid_cache_mutex_);
+      if (grid_cache_.empty()) return;
+    }
+    static const PROJ_FILE_API file_api = {
+      1,
+      grid_open,
+      grid_read,
+      grid_write,
+      grid_seek,
+      grid_tell,
+      grid_close,
+      grid_exists,
+      grid_mkdir,
+      grid_unlink,
+      grid_rename
+    };
+    proj_context_set_fileapi(ctx, &file_api, nullptr);
+  }
+}
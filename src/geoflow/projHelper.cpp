@@ -1,11 +1,74 @@
 #include "geoflow.hpp"
 #include "projHelper.hpp"
+#include "projGridCache.hpp"
+#include "parallel.hpp"
+#include <atomic>
 #include <cstddef>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <proj.h>
 
+#if defined(__SSE2__) || defined(_M_X64)
+  #include <emmintrin.h>
+  #define GF_PROJ_SSE2
+#endif
+
 namespace geoflow {
   static const char *proj_wkt_options[] = {"MULTILINE=NO", NULL};
 
+  static std::atomic<size_t> n_crs_created_ = 0;
+  static std::atomic<size_t> n_transformations_created_ = 0;
+  static std::atomic<size_t> n_cache_hits_ = 0;
+
+  // result[k] = float(coords[k] - offset[k%3]) for n packed xyz points
+  static void subtract_offset(const double* coords, size_t n, const arr3d& offset, float* result) {
+    size_t k = 0, n_values = 3*n;
+  #ifdef GF_PROJ_SSE2
+    // two points (6 values) per iteration, the offset pattern repeats every 3 values
+    const __m128d o0 = _mm_setr_pd(offset[0], offset[1]);
+    const __m128d o1 = _mm_setr_pd(offset[2], offset[0]);
+    const __m128d o2 = _mm_setr_pd(offset[1], offset[2]);
+    for (; k + 6 <= n_values; k += 6) {
+      __m128 f0 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(coords + k), o0));
+      __m128 f1 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(coords + k + 2), o1));
+      __m128 f2 = _mm_cvtpd_ps(_mm_sub_pd(_mm_loadu_pd(coords + k + 4), o2));
+      _mm_storeu_ps(result + k, _mm_movelh_ps(f0, f1));
+      _mm_storel_pi((__m64*)(result + k + 4), f2);
+    }
+  #endif
+    for (; k < n_values; ++k) {
+      result[k] = float(coords[k] - offset[k%3]);
+    }
+  }
+  // coords[k] = points[k] + offset[k%3] for n packed xyz points
+  static void add_offset(const float* points, size_t n, const arr3d& offset, double* coords) {
+    size_t k = 0, n_values = 3*n;
+  #ifdef GF_PROJ_SSE2
+    const __m128d o0 = _mm_setr_pd(offset[0], offset[1]);
+    const __m128d o1 = _mm_setr_pd(offset[2], offset[0]);
+    const __m128d o2 = _mm_setr_pd(offset[1], offset[2]);
+    for (; k + 6 <= n_values; k += 6) {
+      __m128 f01 = _mm_loadu_ps(points + k);
+      __m128 f2 = _mm_castpd_ps(_mm_load_sd((const double*)(points + k + 4)));
+      _mm_storeu_pd(coords + k, _mm_add_pd(_mm_cvtps_pd(f01), o0));
+      _mm_storeu_pd(coords + k + 2, _mm_add_pd(_mm_cvtps_pd(_mm_movehl_ps(f01, f01)), o1));
+      _mm_storeu_pd(coords + k + 4, _mm_add_pd(_mm_cvtps_pd(f2), o2));
+    }
+  #endif
+    for (; k < n_values; ++k) {
+      coords[k] = points[k] + offset[k%3];
+    }
+  }
+
+  ProjObjectStats getProjObjectStats() {
+    ProjObjectStats stats;
+    stats.crs_created = n_crs_created_;
+    stats.transformations_created = n_transformations_created_;
+    stats.cache_hits = n_cache_hits_;
+    return stats;
+  }
+
   struct projHelper : public projHelperInterface {
 
     projHelper(NodeManager& manager) : projHelperInterface(manager) {
@@ -20,24 +83,112 @@ namespace geoflow {
       #endif
     }
 
+    ~projHelper() {
+      thread_transformers.clear();
+      clear_cache();
+      proj_context_destroy(projContext);
+    }
+
     PJ_CONTEXT *projContext = nullptr;
+    // the objects below are owned by the caches, their keys are empty when they are not set
     PJ *processCRS = nullptr;
     PJ *sCRS = nullptr;
     PJ *tCRS = nullptr;
     PJ *projFwdTransform = nullptr;
     PJ *projRevTransform = nullptr;
+    std::string processCRS_key, sCRS_key, tCRS_key;
+
+    // CRS objects by crs_key() and transformations by source and target CRS key, created in projContext. Kept until
+    // proj_clear() so that setting the same CRS or transformation again (eg. every run or every process() call) does
+    // not create new PROJ objects.
+    std::map<std::string, PJ*> crs_cache;
+    std::map<std::pair<std::string, std::string>, PJ*> transformation_cache;
+
+    // set on copies made by create_node_transformer(), they share the data offset of offset_owner
+    projHelper* offset_owner = nullptr;
+    std::mutex data_offset_mutex;
+    bool offset_unpublished = false;
+
+    // identifies the current CRSs, transformations and data offset, thread transformers are recreated when it changes.
+    // Setting and clearing the same transformation again (eg. on every process() call) does not change it.
+    std::string setup_key() const {
+      std::string key = processCRS_key + '\n' + sCRS_key + '\n' + tCRS_key + '\n';
+      key += projFwdTransform ? 'f' : '-';
+      key += projRevTransform ? 'r' : '-';
+      if (data_offset.has_value())
+        key.append(reinterpret_cast<const char*>(data_offset->data()), sizeof(arr3d));
+      return key;
+    }
+    struct ThreadTransformer {
+      std::string setup_key;
+      std::unique_ptr<projHelperInterface> proj;
+    };
+    std::map<std::thread::id, ThreadTransformer> thread_transformers;
+    std::mutex thread_transformers_mutex;
+
+    static std::string crs_key(const char* definition, bool normalize_for_visualization) {
+      return (normalize_for_visualization ? "normalized:" : "") + std::string(definition);
+    }
+    // cached CRS for definition, nullptr if it can not be created
+    PJ* get_crs(const char* definition, bool normalize_for_visualization) {
+      auto key = crs_key(definition, normalize_for_visualization);
+      auto it = crs_cache.find(key);
+      if (it != crs_cache.end()) {
+        ++n_cache_hits_;
+        return it->second;
+      }
+      // https://proj.org/development/reference/functions.html#c.proj_create
+      PJ* crs = proj_create(projContext, definition);
+      if (!crs) return nullptr;
+      if (normalize_for_visualization) {
+        PJ* normalized = proj_normalize_for_visualization(projContext, crs);
+        proj_destroy(crs);
+        crs = normalized;
+        if (!crs) return nullptr;
+      }
+      ++n_crs_created_;
+      crs_cache[key] = crs;
+      return crs;
+    }
+    // cached transformation between two CRSs from the cache, nullptr if it can not be created
+    PJ* get_transformation(const std::string& source_key, const std::string& target_key) {
+      auto key = std::make_pair(source_key, target_key);
+      auto it = transformation_cache.find(key);
+      if (it != transformation_cache.end()) {
+        ++n_cache_hits_;
+        return it->second;
+      }
+      PJ* transformation = proj_create_crs_to_crs_from_pj(projContext, crs_cache.at(source_key), crs_cache.at(target_key), 0, 0);
+      if (!transformation) return nullptr;
+      ++n_transformations_created_;
+      transformation_cache[key] = transformation;
+      return transformation;
+    }
+    void clear_cache() {
+      processCRS = sCRS = tCRS = projFwdTransform = projRevTransform = nullptr;
+      processCRS_key.clear();
+      sCRS_key.clear();
+      tCRS_key.clear();
+      for (auto& [key, pj] : transformation_cache) proj_destroy(pj);
+      for (auto& [key, pj] : crs_cache) proj_destroy(pj);
+      transformation_cache.clear();
+      crs_cache.clear();
+    }
 
     void proj_clear() override {
       data_offset.reset();
+      {
+        std::lock_guard<std::mutex> lock(thread_transformers_mutex);
+        thread_transformers.clear();
+      }
+      clear_cache();
       proj_context_destroy(projContext);
       projContext = proj_context_create();
-      proj_destroy(processCRS);
-      processCRS = nullptr;
-      clear_fwd_crs_transform();
-      clear_rev_crs_transform();
+      installProjGridCache(projContext);
     };
     void proj_construct() override {      
       projContext = proj_context_create();
+      installProjGridCache(projContext);
 
       #ifdef _WIN32
         if(const char* env_p = std::getenv("GF_INSTALL_ROOT")) {
@@ -51,8 +202,9 @@ namespace geoflow {
     };
     void proj_clone_from(const projHelperInterface& other_proj_helper) override {
       const projHelper* other_proj = static_cast<const projHelper*>(&other_proj_helper);
-      data_offset = *other_proj->data_offset;
+      data_offset = other_proj->data_offset;
       projContext = proj_context_clone(other_proj->projContext);
+      installProjGridCache(projContext);
       #ifdef _WIN32
         if(const char* env_p = std::getenv("GF_INSTALL_ROOT")) {
           std::string path = env_p;
@@ -62,33 +214,64 @@ namespace geoflow {
           std::cout << "Setting PROJ DATA dir to " << path << "\n";
         }
       #endif
-      if(other_proj->processCRS) processCRS = proj_clone(projContext, other_proj->processCRS);
-      if(other_proj->projFwdTransform) projFwdTransform = proj_clone(projContext, other_proj->projFwdTransform);
-      if(other_proj->projRevTransform) projRevTransform = proj_clone(projContext, other_proj->projRevTransform);
+      // clones go into the caches under the same keys
+      auto clone_crs = [&](PJ* crs, const std::string& key) -> PJ* {
+        if (!crs) return nullptr;
+        auto it = crs_cache.find(key);
+        if (it != crs_cache.end()) return it->second;
+        return crs_cache[key] = proj_clone(projContext, crs);
+      };
+      processCRS = clone_crs(other_proj->processCRS, other_proj->processCRS_key);
+      processCRS_key = other_proj->processCRS_key;
+      sCRS = clone_crs(other_proj->sCRS, other_proj->sCRS_key);
+      sCRS_key = other_proj->sCRS_key;
+      tCRS = clone_crs(other_proj->tCRS, other_proj->tCRS_key);
+      tCRS_key = other_proj->tCRS_key;
+      if(other_proj->projFwdTransform) 
+        projFwdTransform = transformation_cache[{sCRS_key, processCRS_key}] = proj_clone(projContext, other_proj->projFwdTransform);
+      if(other_proj->projRevTransform) 
+        projRevTransform = transformation_cache[{processCRS_key, tCRS_key}] = proj_clone(projContext, other_proj->projRevTransform);
     };
 
+    // the first transformed point sets the data offset, it is also published as GF_PROCESS_OFFSET_[X|Y|Z] globals
+    void init_data_offset(const double& x, const double& y, const double& z) {
+      if (offset_owner) {
+        std::lock_guard<std::mutex> lock(offset_owner->data_offset_mutex);
+        if (!offset_owner->data_offset.has_value()) {
+          offset_owner->data_offset = arr3d{x, y, z};
+          offset_owner->offset_unpublished = true;
+        }
+        data_offset = offset_owner->data_offset;
+        return;
+      }
+      data_offset = {x, y, z};
+      write_offset_globals(x, y, z);
+    }
+    void write_offset_globals(const double& x, const double& y, const double& z) {
+      if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_X")) {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_X"]->from_json(x);
+      } else {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_X"] = std::make_shared<ParameterByValue<float>>(x, "GF_PROCESS_OFFSET_X", "offset in X coordinate");
+      }
+      if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_Y")) {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_Y"]->from_json(y);
+      } else {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_Y"] = std::make_shared<ParameterByValue<float>>(y, "GF_PROCESS_OFFSET_Y", "offset in Y coordinate");
+      }
+      if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_Z")) {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_Z"]->from_json(z);
+      } else {
+        manager.global_flowchart_params["GF_PROCESS_OFFSET_Z"] = std::make_shared<ParameterByValue<float>>(z, "GF_PROCESS_OFFSET_Z", "offset in Z coordinate");
+      }
+    }
+
     arr3f coord_transform_fwd(const double& x, const double& y, const double& z) override {
       PJ_COORD coord = proj_coord(x, y, z, 0);
 
       if (projFwdTransform) coord = proj_trans(projFwdTransform, PJ_FWD, coord);
 
       if(!data_offset.has_value()) {
-        data_offset = {coord.xyz.x, coord.xyz.y, coord.xyz.z};
-        if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_X")) {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_X"]->from_json(coord.xyz.x);
-        } else {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_X"] = std::make_shared<ParameterByValue<float>>(coord.xyz.x, "GF_PROCESS_OFFSET_X", "offset in X coordinate");
-        }
-        if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_Y")) {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_Y"]->from_json(coord.xyz.y);
-        } else {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_Y"] = std::make_shared<ParameterByValue<float>>(coord.xyz.y, "GF_PROCESS_OFFSET_Y", "offset in Y coordinate");
-        }
-        if(manager.global_flowchart_params.count("GF_PROCESS_OFFSET_Z")) {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_Z"]->from_json(coord.xyz.z);
-        } else {
-          manager.global_flowchart_params["GF_PROCESS_OFFSET_Z"] = std::make_shared<ParameterByValue<float>>(coord.xyz.z, "GF_PROCESS_OFFSET_Z", "offset in Z coordinate");
-        }
+        init_data_offset(coord.xyz.x, coord.xyz.y, coord.xyz.z);
       }
       auto result = arr3f{
         float(coord.xyz.x - (*data_offset)[0]),
@@ -99,6 +282,7 @@ namespace geoflow {
       return result;
     };
     arr3d coord_transform_rev(const float& x, const float& y, const float& z) override {
+      sync_data_offset();
       PJ_COORD coord;
       if(!data_offset.has_value()) {
         coord = proj_coord(x, y, z, 0);
@@ -119,22 +303,77 @@ namespace geoflow {
       return coord_transform_rev(p[0], p[1], p[2]);
     };
 
+    void coord_transform_fwd(double* coords, size_t n, size_t stride, arr3f* result) override {
+      if (n == 0) return;
+      size_t stride_bytes = stride * sizeof(double);
+      if (projFwdTransform) {
+        // https://proj.org/development/reference/functions.html#c.proj_trans_generic
+        // a time array of length 1 is used for all points, t=0 like the scalar version. Without it PROJ uses HUGE_VAL,
+        // which gives different results for time dependent transformations
+        double t = 0;
+        proj_trans_generic(projFwdTransform, PJ_FWD, coords, stride_bytes, n, coords+1, stride_bytes, n, coords+2, stride_bytes, n, &t, 0, 1);
+      }
+      if(!data_offset.has_value()) {
+        init_data_offset(coords[0], coords[1], coords[2]);
+      }
+      if (stride == 3) {
+        subtract_offset(coords, n, *data_offset, result->data());
+        return;
+      }
+      const double ox = (*data_offset)[0], oy = (*data_offset)[1], oz = (*data_offset)[2];
+      for (size_t i=0; i<n; ++i) {
+        const double* c = coords + i*stride;
+        result[i] = {float(c[0] - ox), float(c[1] - oy), float(c[2] - oz)};
+      }
+    };
+    void coord_transform_rev(const arr3f* points, size_t n, double* coords, size_t stride) override {
+      if (n == 0) return;
+      sync_data_offset();
+      arr3d offset = data_offset.value_or(arr3d{0, 0, 0});
+      if (stride == 3) {
+        add_offset(points->data(), n, offset, coords);
+      } else {
+        for (size_t i=0; i<n; ++i) {
+          double* c = coords + i*stride;
+          c[0] = points[i][0] + offset[0];
+          c[1] = points[i][1] + offset[1];
+          c[2] = points[i][2] + offset[2];
+        }
+      }
+      if (projRevTransform) {
+        size_t stride_bytes = stride * sizeof(double);
+        double t = 0;
+        proj_trans_generic(projRevTransform, PJ_FWD, coords, stride_bytes, n, coords+1, stride_bytes, n, coords+2, stride_bytes, n, &t, 0, 1);
+      }
+    };
+
     void set_process_crs(const char* crs) override{
-      // https://proj.org/development/reference/functions.html#c.proj_create
-      processCRS = proj_create(projContext, crs);
-      processCRS = proj_normalize_for_visualization(projContext, processCRS);
+      auto key = crs_key(crs, true);
+      // nothing to do if the definition did not change, the transformations to and from it stay valid
+      if (processCRS && key == processCRS_key) return;
+      clear_fwd_crs_transform();
+      clear_rev_crs_transform();
+      processCRS = get_crs(crs, true);
+      processCRS_key = processCRS ? key : "";
       if (!processCRS)
         throw gfCRSError("Unable to create CRS from string: " + std::string(crs));
     };
     void set_fwd_crs_transform(const char* source_crs, bool normalize_for_visualization = false) override {
       if(processCRS) {
-        sCRS = proj_create(projContext, source_crs);
+        // keep the current transformation if the definition did not change
+        if (sCRS && crs_key(source_crs, normalize_for_visualization) == sCRS_key) return;
+        clear_fwd_crs_transform();
+        sCRS = get_crs(source_crs, normalize_for_visualization);
         if (!sCRS)
           throw gfCRSError("Unable to create source CRS from string: " + std::string(source_crs));
+        sCRS_key = crs_key(source_crs, normalize_for_visualization);
 
-        if (normalize_for_visualization) sCRS = proj_normalize_for_visualization(projContext, sCRS);
-
-        projFwdTransform = proj_create_crs_to_crs_from_pj(projContext, sCRS, processCRS, 0, 0);
+        // no transformation is needed if the source CRS is the process CRS, then only the data offset is applied
+        if (proj_is_equivalent_to(sCRS, processCRS, PJ_COMP_EQUIVALENT)) {
+          std::cout << "Source CRS is equivalent to the process CRS, skipping forward transformation\n";
+          return;
+        }
+        projFwdTransform = get_transformation(sCRS_key, processCRS_key);
 
         if (!projFwdTransform)
           throw gfCRSError("Unable to create forward transformation.");
@@ -144,13 +383,18 @@ namespace geoflow {
     };
     void set_rev_crs_transform(const char* target_crs, bool normalize_for_visualization = false) override {
       if (processCRS) {
-        tCRS = proj_create(projContext, target_crs);
+        if (tCRS && crs_key(target_crs, normalize_for_visualization) == tCRS_key) return;
+        clear_rev_crs_transform();
+        tCRS = get_crs(target_crs, normalize_for_visualization);
         if (!tCRS)
           throw gfCRSError("Unable to create source CRS from string: " + std::string(target_crs));
+        tCRS_key = crs_key(target_crs, normalize_for_visualization);
 
-        if (normalize_for_visualization) tCRS = proj_normalize_for_visualization(projContext, tCRS);
-
-        projRevTransform = proj_create_crs_to_crs_from_pj(projContext, processCRS, tCRS, 0, 0);
+        if (proj_is_equivalent_to(processCRS, tCRS, PJ_COMP_EQUIVALENT)) {
+          std::cout << "Target CRS is equivalent to the process CRS, skipping reverse transformation\n";
+          return;
+        }
+        projRevTransform = get_transformation(processCRS_key, tCRS_key);
 
         if (!projRevTransform)
           throw gfCRSError("Unable to create reverse transformation.");
@@ -177,32 +421,187 @@ namespace geoflow {
         wkt = proj_as_wkt(projContext, tCRS, PJ_WKT1_GDAL, proj_wkt_options);
       return wkt;
     };
+    // cached objects are only unset, they stay in the cache for the next set_*_crs_transform()
     void clear_fwd_crs_transform() override {
-      if (sCRS) {
-        proj_destroy(sCRS);
-        sCRS = nullptr;
-      }
-      if (projFwdTransform) {
-        proj_destroy(projFwdTransform);
-        projFwdTransform = nullptr;
-      }
+      sCRS = nullptr;
+      sCRS_key.clear();
+      projFwdTransform = nullptr;
     };
     void clear_rev_crs_transform() override {
-      if (tCRS) {
-        proj_destroy(tCRS);
-        tCRS = nullptr;
-      }
-      if (projRevTransform) {
-        proj_destroy(projRevTransform);
-        projRevTransform = nullptr;
-      }
+      tCRS = nullptr;
+      tCRS_key.clear();
+      projRevTransform = nullptr;
     };
 
     void set_data_offset(arr3d& offset) override {
       data_offset = offset;
     }
+
+    projHelperInterface& get_thread_transformer() override {
+      std::lock_guard<std::mutex> lock(thread_transformers_mutex);
+      auto& transformer = thread_transformers[std::this_thread::get_id()];
+      auto key = setup_key();
+      if (!transformer.proj || transformer.setup_key != key) {
+        auto proj = std::make_unique<projHelper>(manager);
+        proj->proj_clone_from(*this);
+        proj->data_offset = data_offset;
+        transformer.proj = std::move(proj);
+        transformer.setup_key = std::move(key);
+      }
+      return *transformer.proj;
+    }
+
+    std::unique_ptr<projHelperInterface> create_node_transformer() override {
+      // the clone reads the PROJ objects of this projHelper, which may happen from several node threads
+      std::lock_guard<std::mutex> lock(thread_transformers_mutex);
+      auto proj = std::make_unique<projHelper>(manager);
+      proj->proj_clone_from(*this);
+      proj->offset_owner = this;
+      std::lock_guard<std::mutex> offset_lock(data_offset_mutex);
+      proj->data_offset = data_offset;
+      return proj;
+    }
+    void sync_data_offset() override {
+      if (!offset_owner || data_offset.has_value()) return;
+      std::lock_guard<std::mutex> lock(offset_owner->data_offset_mutex);
+      if (offset_owner->data_offset.has_value()) {
+        data_offset = offset_owner->data_offset;
+      }
+    }
+    void publish_data_offset() override {
+      std::lock_guard<std::mutex> lock(data_offset_mutex);
+      if (!offset_unpublished || !data_offset.has_value()) return;
+      offset_unpublished = false;
+      write_offset_globals((*data_offset)[0], (*data_offset)[1], (*data_offset)[2]);
+    }
+
+    // number of tasks for transforming n points in parallel
+    static size_t transform_tasks(size_t n) {
+      const size_t min_points_per_task = 100000;
+      return std::max<size_t>(1, std::min(get_concurrency(), n / min_points_per_task));
+    }
+    void coord_transform_fwd_parallel(double* coords, size_t n, size_t stride, arr3f* result) override {
+      size_t n_tasks = transform_tasks(n);
+      if (n_tasks == 1) return coord_transform_fwd(coords, n, stride, result);
+      // all tasks must use the same data offset, take it from a copy of the first point because coords is overwritten
+      if (!data_offset.has_value()) {
+        double first[3] = {coords[0], coords[1], coords[2]};
+        coord_transform_fwd(first, 1, 3, result);
+      }
+      parallel_invoke(n_tasks, [&](size_t i) {
+        size_t begin = n * i / n_tasks, end = n * (i+1) / n_tasks;
+        get_thread_transformer().coord_transform_fwd(coords + begin*stride, end-begin, stride, result + begin);
+      });
+    }
+    void coord_transform_rev_parallel(const arr3f* points, size_t n, double* coords, size_t stride) override {
+      size_t n_tasks = transform_tasks(n);
+      if (n_tasks == 1) return coord_transform_rev(points, n, coords, stride);
+      sync_data_offset();
+      parallel_invoke(n_tasks, [&](size_t i) {
+        size_t begin = n * i / n_tasks, end = n * (i+1) / n_tasks;
+        get_thread_transformer().coord_transform_rev(points + begin, end-begin, coords + begin*stride, stride);
+      });
+    }
+  };
+
+
+  void projHelperInterface::coord_transform_fwd(vec3f& points) {
+    if (points.empty()) return;
+    std::vector<arr3d> coords(points.size());
+    for (size_t i=0; i<points.size(); ++i) {
+      coords[i] = {points[i][0], points[i][1], points[i][2]};
+    }
+    coord_transform_fwd(coords.data()->data(), coords.size(), 3, points.data());
+  }
+  void projHelperInterface::coord_transform_fwd(LinearRing& ring) {
+    // exterior and interior rings in one batch
+    std::vector<arr3d> coords;
+    coords.reserve(ring.vertex_count());
+    for (auto& p : ring) coords.push_back({p[0], p[1], p[2]});
+    for (auto& iring : ring.interior_rings()) {
+      for (auto& p : iring) coords.push_back({p[0], p[1], p[2]});
+    }
+    if (coords.empty()) return;
+    std::vector<arr3f> result(coords.size());
+    coord_transform_fwd(coords.data()->data(), coords.size(), 3, result.data());
+    size_t i = 0;
+    for (auto& p : ring) p = result[i++];
+    for (auto& iring : ring.interior_rings()) {
+      for (auto& p : iring) p = result[i++];
+    }
+    ring.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_fwd(LineString& line) {
+    coord_transform_fwd(static_cast<vec3f&>(line));
+    line.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_fwd(PointCollection& points) {
+    coord_transform_fwd(static_cast<vec3f&>(points));
+    points.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_fwd(LinearRingCollection& rings) {
+    // all rings in one batch
+    std::vector<arr3d> coords;
+    coords.reserve(rings.vertex_count());
+    for (auto& ring : rings) {
+      for (auto& p : ring) coords.push_back({p[0], p[1], p[2]});
+    }
+    if (coords.empty()) return;
+    std::vector<arr3f> result(coords.size());
+    coord_transform_fwd(coords.data()->data(), coords.size(), 3, result.data());
+    size_t i = 0;
+    for (auto& ring : rings) {
+      for (auto& p : ring) p = result[i++];
+    }
+    rings.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_fwd(FlatGeometryCollection& geometries) {
+    // the coordinates are already contiguous
+    coord_transform_fwd(geometries.coordinates());
+    geometries.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_fwd(const QuantizedPointCollection& points, PointCollection& result) {
+    // bounds the size of the double buffer for very large collections
+    const size_t chunk_size = 1 << 20;
+    auto& q = points.quantized();
+    auto& scale = points.scale();
+    auto& offset = points.offset();
+    result.resize(points.size());
+    std::vector<arr3d> coords(std::min(chunk_size, points.size()));
+    for (size_t begin = 0; begin < points.size(); begin += chunk_size) {
+      size_t n = std::min(chunk_size, points.size() - begin);
+      for (size_t i = 0; i < n; ++i) {
+        for (size_t c = 0; c < 3; ++c) coords[i][c] = offset[c] + scale[c] * q[begin + i][c];
+      }
+      coord_transform_fwd_parallel(coords.data()->data(), n, 3, result.data() + begin);
+    }
+    result.get_attributes() = points.get_attributes();
+    result.invalidate_box();
+  }
+  void projHelperInterface::coord_transform_rev(const vec3f& points, std::vector<arr3d>& result) {
+    result.resize(points.size());
+    if (points.empty()) return;
+    coord_transform_rev(points.data(), points.size(), result.data()->data(), 3);
+  }
+
+  // the ProjHelperHandle that gives the calling thread its own copy, and that copy once it is created
+  struct ThreadNodeTransformer {
+    const ProjHelperHandle* handle = nullptr;
+    std::unique_ptr<projHelperInterface> proj;
   };
+  static thread_local ThreadNodeTransformer thread_node_transformer_;
 
+  projHelperInterface* ProjHelperHandle::get() const {
+    auto& t = thread_node_transformer_;
+    if (t.handle != this) return proj_.get();
+    if (!t.proj) t.proj = proj_->create_node_transformer();
+    return t.proj.get();
+  }
+  void ProjHelperHandle::use_node_transformer(bool enable) const {
+    auto& t = thread_node_transformer_;
+    t.proj.reset();
+    t.handle = enable ? this : nullptr;
+  }
 
   std::unique_ptr<projHelperInterface> createProjHelper(NodeManager& manager) {
     return std::make_unique<projHelper>(manager);
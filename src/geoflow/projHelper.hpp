@@ -11,6 +11,7 @@ namespace geoflow {
     std::optional<arr3d> data_offset;
 
     projHelperInterface(NodeManager& manager) : manager(manager) {};
+    virtual ~projHelperInterface() {};
 
     virtual void proj_construct() = 0;
     virtual void proj_clone_from(const projHelperInterface&) = 0;
@@ -20,6 +21,34 @@ namespace geoflow {
     virtual arr3d coord_transform_rev(const float& x, const float& y, const float& z) = 0;
     virtual arr3d coord_transform_rev(const arr3f& p) = 0;
 
+    // Batch versions of the above that transform all points with a single PROJ call and apply the data offset in a
+    // separate pass. stride is the distance between consecutive points in number of doubles, x, y and z are the first
+    // three. The fwd version overwrites coords with the transformed coordinates (before the offset is subtracted).
+    virtual void coord_transform_fwd(double* coords, size_t n, size_t stride, arr3f* result) = 0;
+    virtual void coord_transform_rev(const arr3f* points, size_t n, double* coords, size_t stride) = 0;
+    // in place, points are read as coordinates in the source CRS of the forward transform. The geometry overloads also
+    // reset the cached box of the geometry, use them instead of the vec3f one for geometries
+    void coord_transform_fwd(vec3f& points);
+    // including its interior rings
+    void coord_transform_fwd(LinearRing& ring);
+    void coord_transform_fwd(LineString& line);
+    void coord_transform_fwd(PointCollection& points);
+    void coord_transform_fwd(LinearRingCollection& rings);
+    void coord_transform_fwd(FlatGeometryCollection& geometries);
+    // points are decoded in chunks straight into the transform buffer, the attributes are copied to result
+    void coord_transform_fwd(const QuantizedPointCollection& points, PointCollection& result);
+    void coord_transform_rev(const vec3f& points, std::vector<arr3d>& result);
+
+    // PROJ objects must not be used by more than one thread at a time. This returns a copy of this projHelper, with its
+    // own PJ_CONTEXT and clones of the current CRSs, transformations and data offset, that belongs to the calling thread.
+    // It is created on first use and recreated after the CRS setup or data offset of this projHelper changed. Set the
+    // data offset before transforming with it from multiple threads.
+    virtual projHelperInterface& get_thread_transformer() = 0;
+    // Same as the batch coord_transform_fwd/rev, but large arrays are split over the workers of the shared executor
+    // (see parallel.hpp), each using its own thread transformer.
+    virtual void coord_transform_fwd_parallel(double* coords, size_t n, size_t stride, arr3f* result) = 0;
+    virtual void coord_transform_rev_parallel(const arr3f* points, size_t n, double* coords, size_t stride) = 0;
+
     virtual void set_process_crs(const char* crs) = 0;
     virtual void set_fwd_crs_transform(const char* source_crs, bool normalize_for_visualization = false) = 0;
     virtual void set_rev_crs_transform(const char* target_crs, bool normalize_for_visualization = false) = 0;
@@ -30,7 +59,58 @@ namespace geoflow {
     virtual void clear_rev_crs_transform() = 0;
 
     virtual void set_data_offset(arr3d& offset) = 0;
+
+    // A copy of this projHelper for a node that is processed concurrently with other nodes, with its own PJ_CONTEXT and
+    // clones of the current CRSs and transformations. The copies share the data offset of this projHelper: the first
+    // point any of them transforms sets it here, under a lock. They do not write the GF_PROCESS_OFFSET_[X|Y|Z] globals,
+    // publish_data_offset() does that for them.
+    virtual std::unique_ptr<projHelperInterface> create_node_transformer() = 0;
+    // on a copy, take over the shared data offset if another copy has set it in the meantime
+    virtual void sync_data_offset() {};
+    // set the GF_PROCESS_OFFSET_[X|Y|Z] globals to a data offset that was set by a copy and not yet published
+    virtual void publish_data_offset() = 0;
+  };
+
+  // Owns the projHelper of a NodeManager. On a thread that called use_node_transformer(), -> and * return a copy made with
+  // projHelperInterface::create_node_transformer() instead, created on first use. That way nodes that run concurrently
+  // do not share PROJ objects or CRS setup, while they keep using manager.proj as usual.
+  class ProjHelperHandle {
+    std::unique_ptr<projHelperInterface> proj_;
+    public:
+    ProjHelperHandle& operator=(std::unique_ptr<projHelperInterface> proj) {
+      proj_ = std::move(proj);
+      return *this;
+    };
+    projHelperInterface* get() const;
+    projHelperInterface* operator->() const { return get(); };
+    projHelperInterface& operator*() const { return *get(); };
+
+    // start or stop (enable=false) giving the calling thread its own copy of the projHelper
+    void use_node_transformer(bool enable) const;
   };
 
   std::unique_ptr<projHelperInterface> createProjHelper(NodeManager& manager);
+
+  // Number of PROJ objects created by all projHelpers in this process. CRS and transformation objects are cached by
+  // definition in each projHelper, cache_hits counts the times a cached object was reused instead of created.
+  struct ProjObjectStats {
+    size_t crs_created = 0;
+    size_t transformations_created = 0;
+    size_t cache_hits = 0;
+  };
+  ProjObjectStats getProjObjectStats();
+
+  // Grid files (eg. the RDNAPTRANS grids in resources/) that PROJ reads from a process wide, read-only memory mapped
+  // cache instead of from disk. Requests for a file with the same file name are served from the cache, whatever its
+  // directory. The initial list is read from the GF_PROJ_GRID_CACHE environment variable (separated by ':', or ';' on
+  // Windows). Only PROJ contexts created after this call use the cache.
+  void setProjGridCacheFiles(const std::vector<std::string>& filepaths);
+  struct ProjGridCacheStats {
+    size_t files = 0;
+    size_t bytes = 0;
+    // file opens served from the cache and from disk
+    size_t hits = 0;
+    size_t misses = 0;
+  };
+  ProjGridCacheStats getProjGridCacheStats();
 }
@@ -0,0 +1,119 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "run_history.hpp"
+
+using json = nlohmann::json;
+
+namespace geoflow {
+
+  size_t get_current_rss() {
+  #ifdef __linux__
+    // second field of statm is the number of resident pages
+    std::ifstream ifs("/proc/self/statm");
+    size_t total_pages, resident_pages;
+    if (ifs >> total_pages >> resident_pages)
+      return resident_pages * size_t(sysconf(_SC_PAGESIZE));
+  #endif
+    return 0;
+  }
+
+  // recent runs should weigh in, so the running mean is taken over at most this many runs
+  static const size_t max_mean_window = 16;
+
+  void NodeRunStats::add(double ms) {
+    ++count;
+    double n = double(std::min(count, max_mean_window));
+    mean_ms += (ms - mean_ms) / n;
+    max_ms = std::max(max_ms, ms);
+  }
+
+  RunHistory::RunHistory(const std::string& filepath) : filepath_(filepath) {};
+
+  std::string RunHistory::make_key(const std::string& flowchart_hash, const std::string& type_name, const std::string& node_name) {
+    return flowchart_hash + "/" + type_name + "/" + node_name;
+  }
+
+  void RunHistory::load() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filepath_.empty()) return;
+    std::ifstream ifs(filepath_);
+    if (!ifs.is_open()) return;
+    try {
+      json j;
+      ifs >> j;
+      for (auto& [key, val] : j.at("nodes").items()) {
+        NodeRunStats s;
+        s.count = val.at("count").get<size_t>();
+        s.mean_ms = val.at("mean_ms").get<double>();
+        s.max_ms = val.at("max_ms").get<double>();
+        stats_[key] = s;
+      }
+    } catch (const std::exception& e) {
+      std::cerr << "Unable to read run history from " << filepath_ << ", starting with an empty history\n";
+      stats_.clear();
+    }
+  }
+
+  void RunHistory::save() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (filepath_.empty()) return;
+    json j;
+    j["nodes"] = json::object();
+    for (auto& [key, s] : stats_) {
+      j["nodes"][key] = {{"count", s.count}, {"mean_ms", s.mean_ms}, {"max_ms", s.max_ms}};
+    }
+    std::ofstream ofs(filepath_);
+    if (!ofs.is_open()) {
+      std::cerr << "Unable to write run history to " << filepath_ << "\n";
+      return;
+    }
+    ofs << std::setw(2) << j << std::endl;
+  }
+
+  void RunHistory::record(const std::string& key, double ms) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_[key].add(ms);
+  }
+
+  std::optional<NodeRunStats> RunHistory::get(const std::string& key) const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = stats_.find(key);
+    if (it == stats_.end()) return std::nullopt;
+    return it->second;
+  }
+
+  std::optional<double> RunHistory::estimate_ms(const std::string& key) const {
+    if (auto s = get(key)) return s->mean_ms;
+    return std::nullopt;
+  }
+
+  size_t RunHistory::size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_.size();
+  }
+}
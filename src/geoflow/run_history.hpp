@@ -0,0 +1,60 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+
+namespace geoflow {
+
+  // resident set size of this process in bytes, 0 if it can not be determined on this platform
+  size_t get_current_rss();
+
+  struct NodeRunStats {
+    size_t count = 0;
+    double mean_ms = 0;
+    double max_ms = 0;
+
+    void add(double ms);
+  };
+
+  // Runtime statistics of nodes collected over previous runs, optionally
+  // persisted in a small json file. Nodes are identified by their type, name
+  // and the hash of the flowchart they are part of (see NodeManager::flowchart_hash).
+  class RunHistory {
+    std::string filepath_;
+    std::map<std::string, NodeRunStats> stats_;
+    mutable std::mutex mutex_;
+
+    public:
+    RunHistory(const std::string& filepath="");
+
+    static std::string make_key(const std::string& flowchart_hash, const std::string& type_name, const std::string& node_name);
+
+    // read the history file, a missing file results in an empty history
+    void load();
+    // write the history file, does nothing if no filepath was set
+    void save() const;
+
+    void record(const std::string& key, double ms);
+    std::optional<NodeRunStats> get(const std::string& key) const;
+    std::optional<double> estimate_ms(const std::string& key) const;
+    size_t size() const;
+  };
+}
@@ -0,0 +1,76 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <iterator>
+
+#include "selection.hpp"
+#include "geoflow.hpp"
+
+namespace geoflow {
+
+  Selection::Selection(std::vector<size_t> rows, size_t source_size) 
+    : rows_(std::move(rows)), source_size_(source_size) {
+    if (!rows_.empty() && rows_.back() >= source_size_)
+      throw gfException("Selection row " + std::to_string(rows_.back()) + " is out of range for a source of size " + std::to_string(source_size_));
+  };
+
+  Selection Selection::all(size_t source_size) {
+    std::vector<size_t> rows(source_size);
+    for (size_t i=0; i<source_size; ++i) rows[i] = i;
+    return Selection(std::move(rows), source_size);
+  }
+
+  Selection Selection::from_bitmap(const std::vector<bool>& bitmap) {
+    std::vector<size_t> rows;
+    for (size_t i=0; i<bitmap.size(); ++i) {
+      if (bitmap[i]) rows.push_back(i);
+    }
+    return Selection(std::move(rows), bitmap.size());
+  }
+
+  std::vector<bool> Selection::to_bitmap() const {
+    std::vector<bool> bitmap(source_size_, false);
+    for (auto i : rows_) bitmap[i] = true;
+    return bitmap;
+  }
+
+  Selection Selection::intersect(const Selection& other) const {
+    if (source_size_ != other.source_size_)
+      throw gfException("Can not intersect selections of sources with different sizes");
+    std::vector<size_t> rows;
+    std::set_intersection(rows_.begin(), rows_.end(), other.rows_.begin(), other.rows_.end(), std::back_inserter(rows));
+    return Selection(std::move(rows), source_size_);
+  }
+
+  Selection Selection::compose(const Selection& inner) const {
+    if (inner.source_size_ != rows_.size())
+      throw gfException("Can not compose selections, inner selection does not index the rows of the outer selection");
+    std::vector<size_t> rows;
+    rows.reserve(inner.size());
+    for (auto i : inner) rows.push_back(rows_[i]);
+    return Selection(std::move(rows), source_size_);
+  }
+
+  std::vector<std::any> select(const std::vector<std::any>& data, const Selection& selection) {
+    if (data.size() != selection.source_size())
+      throw gfException("Selection of a source with " + std::to_string(selection.source_size()) + " elements can not be applied to " + std::to_string(data.size()) + " elements");
+    std::vector<std::any> result;
+    result.reserve(selection.size());
+    for (auto i : selection) result.push_back(data[i]);
+    return result;
+  }
+}
@@ -0,0 +1,58 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <any>
+#include <vector>
+
+namespace geoflow {
+
+  // Sorted row indices into the columns of a poly terminal (or any other vector terminal) with source_size elements.
+  // Nodes that drop rows can output a Selection instead of copying every column, consumers then read the selected rows
+  // in place and only materialise a copy with select() when they need contiguous data.
+  class Selection {
+    std::vector<size_t> rows_;
+    size_t source_size_ = 0;
+
+    public:
+    Selection() {};
+    // rows must be sorted and smaller than source_size
+    Selection(std::vector<size_t> rows, size_t source_size);
+
+    // every row of a source with source_size elements
+    static Selection all(size_t source_size);
+    static Selection from_bitmap(const std::vector<bool>& bitmap);
+    std::vector<bool> to_bitmap() const;
+
+    size_t size() const { return rows_.size(); };
+    bool empty() const { return rows_.empty(); };
+    size_t source_size() const { return source_size_; };
+    size_t operator[](size_t i) const { return rows_[i]; };
+    const std::vector<size_t>& rows() const { return rows_; };
+    std::vector<size_t>::const_iterator begin() const { return rows_.begin(); };
+    std::vector<size_t>::const_iterator end() const { return rows_.end(); };
+
+    // rows in both selections, both must index the same source
+    Selection intersect(const Selection& other) const;
+    // inner indexes the rows of this selection (eg. it was computed on data materialised with select()), the result
+    // indexes the source of this selection
+    Selection compose(const Selection& inner) const;
+  };
+
+  // copy of the selected elements of data
+  std::vector<std::any> select(const std::vector<std::any>& data, const Selection& selection);
+}
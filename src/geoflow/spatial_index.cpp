@@ -0,0 +1,418 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <type_traits>
+
+#include "spatial_index.hpp"
+#include "bbox_kernels.hpp"
+#include "parallel.hpp"
+#include "geoflow.hpp"
+
+namespace geoflow {
+
+  uint32_t hilbert_key(uint32_t x, uint32_t y) {
+    const uint32_t n = 1u << 16;
+    uint32_t d = 0;
+    for (uint32_t s = n/2; s > 0; s /= 2) {
+      uint32_t rx = (x & s) > 0;
+      uint32_t ry = (y & s) > 0;
+      d += s * s * ((3 * rx) ^ ry);
+      // rotate the quadrant
+      if (ry == 0) {
+        if (rx == 1) {
+          x = n-1 - x;
+          y = n-1 - y;
+        }
+        std::swap(x, y);
+      }
+    }
+    return d;
+  }
+
+  static uint32_t spread_bits(uint32_t v) {
+    v &= 0x0000ffff;
+    v = (v | (v << 8)) & 0x00ff00ff;
+    v = (v | (v << 4)) & 0x0f0f0f0f;
+    v = (v | (v << 2)) & 0x33333333;
+    v = (v | (v << 1)) & 0x55555555;
+    return v;
+  }
+  uint32_t morton_key(uint32_t x, uint32_t y) {
+    return spread_bits(x) | (spread_bits(y) << 1);
+  }
+
+  vec1ui spatial_order(const vec3f& points, SpaceFillingCurve curve) {
+    if (points.size() > std::numeric_limits<uint32_t>::max()) {
+      throw gfException("spatial_order supports at most " + std::to_string(std::numeric_limits<uint32_t>::max()) + " points");
+    }
+    std::array<float, 4> ext = {std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest()};
+    for (auto& p : points) {
+      if (std::isnan(p[0]) || std::isnan(p[1])) continue;
+      ext[0] = std::min(ext[0], p[0]); ext[1] = std::min(ext[1], p[1]);
+      ext[2] = std::max(ext[2], p[0]); ext[3] = std::max(ext[3], p[1]);
+    }
+    const float max_coord = 65535;
+    float sx = ext[2] > ext[0] ? max_coord / (ext[2] - ext[0]) : 0;
+    float sy = ext[3] > ext[1] ? max_coord / (ext[3] - ext[1]) : 0;
+
+    // 64 bit sort keys: curve position in the high bits, input index in the low bits
+    std::vector<uint64_t> keys(points.size());
+    parallel_for(points.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        auto& p = points[i];
+        uint64_t key = std::numeric_limits<uint32_t>::max();
+        if (!std::isnan(p[0]) && !std::isnan(p[1])) {
+          uint32_t x = uint32_t(std::min(std::max((p[0] - ext[0]) * sx, 0.f), max_coord));
+          uint32_t y = uint32_t(std::min(std::max((p[1] - ext[1]) * sy, 0.f), max_coord));
+          key = curve == GF_MORTON ? morton_key(x, y) : hilbert_key(x, y);
+        }
+        keys[i] = (key << 32) | i;
+      }
+    }, 1 << 14);
+    parallel_sort(keys.begin(), keys.end(), std::less<uint64_t>());
+
+    vec1ui order(points.size());
+    for (size_t i = 0; i < keys.size(); ++i) order[i] = keys[i] & 0xffffffff;
+    return order;
+  }
+
+  static void kd_split(const vec3f& points, const vec1ui& weights, size_t target_weight, vec1ui::iterator first, vec1ui::iterator last, std::vector<vec1ui>& groups) {
+    size_t total = 0;
+    for (auto it = first; it != last; ++it) total += weights[*it];
+    size_t n_groups = (total + target_weight - 1) / target_weight;
+    if (n_groups <= 1 || last - first == 1) {
+      groups.emplace_back(first, last);
+      std::sort(groups.back().begin(), groups.back().end());
+      return;
+    }
+    arr3f pmin = points[*first], pmax = points[*first];
+    for (auto it = first; it != last; ++it) {
+      for (size_t c = 0; c < 2; ++c) {
+        pmin[c] = std::min(pmin[c], points[*it][c]);
+        pmax[c] = std::max(pmax[c], points[*it][c]);
+      }
+    }
+    size_t axis = (pmax[0] - pmin[0]) >= (pmax[1] - pmin[1]) ? 0 : 1;
+    std::sort(first, last, [&](size_t a, size_t b) {
+      return points[a][axis] < points[b][axis];
+    });
+    // the left part gets the weight for half of the groups, rounded down
+    size_t left_weight = total * (n_groups / 2) / n_groups, acc = 0;
+    auto mid = first;
+    while (mid != last - 1 && acc + weights[*mid] / 2 < left_weight) acc += weights[*mid++];
+    if (mid == first) ++mid;
+    kd_split(points, weights, target_weight, first, mid, groups);
+    kd_split(points, weights, target_weight, mid, last, groups);
+  }
+
+  std::vector<vec1ui> kd_partition(const vec3f& points, const vec1ui& weights, size_t target_weight) {
+    std::vector<vec1ui> groups;
+    vec1ui valid, invalid;
+    for (size_t i = 0; i < points.size(); ++i) {
+      if (std::isnan(points[i][0]) || std::isnan(points[i][1])) invalid.push_back(i);
+      else valid.push_back(i);
+    }
+    if (!valid.empty()) kd_split(points, weights, std::max(target_weight, size_t(1)), valid.begin(), valid.end(), groups);
+    if (!invalid.empty()) groups.push_back(std::move(invalid));
+    return groups;
+  }
+
+  std::optional<Box> geometry_box(const std::any& geometry) {
+    Box box;
+    bool is_geometry = visit_geometry(geometry, [&box](auto& g) {
+      typedef std::decay_t<decltype(g)> T;
+      if constexpr (std::is_same_v<T, TriangleCollection>) {
+        if (!g.empty()) box.add(g[0][0].data(), 3 * g.size());
+      } else if constexpr (std::is_same_v<T, SegmentCollection>) {
+        if (!g.empty()) box.add(g[0][0].data(), 2 * g.size());
+      } else if constexpr (std::is_same_v<T, LineStringCollection> || std::is_same_v<T, LinearRingCollection>) {
+        for (auto& part : g) box.add(part);
+      } else if constexpr (std::is_same_v<T, MultiTriangleCollection>) {
+        for (auto& tc : g.get_tricollections()) {
+          if (!tc.empty()) box.add(tc[0][0].data(), 3 * tc.size());
+        }
+      } else if constexpr (std::is_same_v<T, IndexedMesh>) {
+        box.add(g.vertices());
+      } else if constexpr (std::is_same_v<T, Mesh>) {
+        for (auto& polygon : g.get_polygons()) box.add(polygon);
+      } else {
+        // LinearRing, LineString and PointCollection
+        box.add(g);
+      }
+    });
+    if (!is_geometry) {
+      if (auto p = std::any_cast<arr3f>(&geometry)) box.add(*p);
+    }
+    if (box.isEmpty()) return std::nullopt;
+    return box;
+  }
+
+  static const float inf = std::numeric_limits<float>::infinity();
+  // stand-in for empty boxes, it intersects nothing
+  static const std::array<float, 4> no_box = {inf, inf, -inf, -inf};
+
+  static bool is_valid(const float* b) {
+    return b[0] <= b[2] && b[1] <= b[3];
+  }
+  static bool intersects(const float* b, const float* q) {
+    return b[0] <= q[2] && b[2] >= q[0] && b[1] <= q[3] && b[3] >= q[1];
+  }
+  static float squared_distance(const float* b, float x, float y) {
+    float dx = std::max(std::max(b[0] - x, 0.f), x - b[2]);
+    float dy = std::max(std::max(b[1] - y, 0.f), y - b[3]);
+    return dx*dx + dy*dy;
+  }
+  static std::array<float, 4> to_xy_box(const Box& box) {
+    if (box.isEmpty()) return no_box;
+    auto pmin = box.min(), pmax = box.max();
+    return {pmin[0], pmin[1], pmax[0], pmax[1]};
+  }
+
+  SpatialIndex::SpatialIndex(const std::vector<Box>& boxes, size_t node_size) : node_size_(node_size) {
+    std::vector<float> item_boxes(4*boxes.size());
+    for (size_t i = 0; i < boxes.size(); ++i) {
+      auto b = to_xy_box(boxes[i]);
+      std::copy(b.begin(), b.end(), item_boxes.begin() + 4*i);
+    }
+    build(item_boxes);
+  }
+  SpatialIndex::SpatialIndex(const LinearRingCollection& rings, size_t node_size) : node_size_(node_size) {
+    std::vector<float> item_boxes(4*rings.size());
+    parallel_for(rings.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        auto& ring = rings[i];
+        float* b = &item_boxes[4*i];
+        if (ring.empty()) {
+          std::copy(no_box.begin(), no_box.end(), b);
+          continue;
+        }
+        arr3f pmin = ring[0], pmax = ring[0];
+        bbox_reduce(ring[0].data(), ring.size(), pmin, pmax);
+        b[0] = pmin[0]; b[1] = pmin[1]; b[2] = pmax[0]; b[3] = pmax[1];
+      }
+    }, 1024);
+    build(item_boxes);
+  }
+  SpatialIndex::SpatialIndex(const PointCollection& points, size_t node_size) : node_size_(node_size) {
+    std::vector<float> item_boxes(4*points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      float* b = &item_boxes[4*i];
+      b[0] = b[2] = points[i][0];
+      b[1] = b[3] = points[i][1];
+    }
+    build(item_boxes);
+  }
+  SpatialIndex::SpatialIndex(const TriangleCollection& triangles, size_t node_size) : node_size_(node_size) {
+    std::vector<float> item_boxes(4*triangles.size());
+    for (size_t i = 0; i < triangles.size(); ++i) {
+      auto& t = triangles[i];
+      float* b = &item_boxes[4*i];
+      b[0] = std::min({t[0][0], t[1][0], t[2][0]});
+      b[1] = std::min({t[0][1], t[1][1], t[2][1]});
+      b[2] = std::max({t[0][0], t[1][0], t[2][0]});
+      b[3] = std::max({t[0][1], t[1][1], t[2][1]});
+    }
+    build(item_boxes);
+  }
+
+  void SpatialIndex::build(const std::vector<float>& item_boxes) {
+    n_items_ = item_boxes.size() / 4;
+    if (n_items_ >= std::numeric_limits<uint32_t>::max()) {
+      throw gfException("SpatialIndex supports at most " + std::to_string(std::numeric_limits<uint32_t>::max()-1) + " items");
+    }
+    node_size_ = std::min(std::max(node_size_, size_t(2)), size_t(65535));
+    boxes_.clear();
+    indices_.clear();
+    level_bounds_.clear();
+    if (n_items_ == 0) return;
+
+    // node count per level, there is always at least one level above the leaves
+    size_t n = n_items_, n_nodes = n;
+    level_bounds_.push_back(n_nodes);
+    do {
+      n = (n + node_size_ - 1) / node_size_;
+      n_nodes += n;
+      level_bounds_.push_back(n_nodes);
+    } while (n != 1);
+
+    std::array<float, 4> ext = no_box;
+    for (size_t i = 0; i < n_items_; ++i) {
+      const float* b = &item_boxes[4*i];
+      if (!is_valid(b)) continue;
+      ext[0] = std::min(ext[0], b[0]); ext[1] = std::min(ext[1], b[1]);
+      ext[2] = std::max(ext[2], b[2]); ext[3] = std::max(ext[3], b[3]);
+    }
+
+    // sort the items along the hilbert curve, empty boxes go last
+    const float max_coord = 65535;
+    float sx = ext[2] > ext[0] ? max_coord / (ext[2] - ext[0]) : 0;
+    float sy = ext[3] > ext[1] ? max_coord / (ext[3] - ext[1]) : 0;
+    std::vector<std::pair<uint32_t, uint32_t>> order(n_items_);
+    parallel_for(n_items_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        const float* b = &item_boxes[4*i];
+        uint32_t key = std::numeric_limits<uint32_t>::max();
+        if (is_valid(b)) {
+          float cx = std::min(std::max(((b[0] + b[2]) / 2 - ext[0]) * sx, 0.f), max_coord);
+          float cy = std::min(std::max(((b[1] + b[3]) / 2 - ext[1]) * sy, 0.f), max_coord);
+          key = hilbert_key(uint32_t(cx), uint32_t(cy));
+        }
+        order[i] = {key, uint32_t(i)};
+      }
+    }, 1 << 14);
+    parallel_sort(order.begin(), order.end(), std::less<std::pair<uint32_t, uint32_t>>());
+
+    boxes_.resize(4*n_nodes);
+    indices_.resize(n_nodes);
+    parallel_for(n_items_, [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        uint32_t id = order[i].second;
+        std::copy(&item_boxes[4*id], &item_boxes[4*id] + 4, &boxes_[4*i]);
+        indices_[i] = id;
+      }
+    }, 1 << 14);
+
+    // every node holds the union of the boxes of its (at most node_size_) children
+    for (size_t level = 1; level < level_bounds_.size(); ++level) {
+      size_t child_begin = level == 1 ? 0 : level_bounds_[level-2];
+      size_t child_end = level_bounds_[level-1];
+      size_t node_begin = level_bounds_[level-1];
+      size_t n_level = level_bounds_[level] - node_begin;
+      parallel_for(n_level, [&](size_t begin, size_t end) {
+        for (size_t j = begin; j < end; ++j) {
+          size_t first = child_begin + j*node_size_, last = std::min(first + node_size_, child_end);
+          float* b = &boxes_[4*(node_begin + j)];
+          std::copy(no_box.begin(), no_box.end(), b);
+          for (size_t c = first; c < last; ++c) {
+            const float* cb = &boxes_[4*c];
+            b[0] = std::min(b[0], cb[0]); b[1] = std::min(b[1], cb[1]);
+            b[2] = std::max(b[2], cb[2]); b[3] = std::max(b[3], cb[3]);
+          }
+          indices_[node_begin + j] = uint32_t(first);
+        }
+      }, 1024);
+    }
+  }
+
+  Box SpatialIndex::extent() const {
+    Box box;
+    if (n_items_ && is_valid(&boxes_[boxes_.size()-4])) {
+      const float* b = &boxes_[boxes_.size()-4];
+      box.set({b[0], b[1], 0}, {b[2], b[3], 0});
+    }
+    return box;
+  }
+
+  void SpatialIndex::search(const Box& query, std::vector<size_t>& result) const {
+    if (n_items_ == 0) return;
+    auto q = to_xy_box(query);
+    if (!is_valid(q.data())) return;
+    size_t root = indices_.size() - 1;
+    if (!intersects(&boxes_[4*root], q.data())) return;
+
+    // pairs of node position and level
+    std::vector<std::pair<size_t, size_t>> stack = {{root, level_bounds_.size()-1}};
+    while (!stack.empty()) {
+      auto [pos, level] = stack.back();
+      stack.pop_back();
+      size_t first = indices_[pos], last = std::min(first + node_size_, level_bounds_[level-1]);
+      for (size_t c = first; c < last; ++c) {
+        if (!intersects(&boxes_[4*c], q.data())) continue;
+        if (level == 1) result.push_back(indices_[c]);
+        else stack.push_back({c, level-1});
+      }
+    }
+  }
+  std::vector<size_t> SpatialIndex::search(const Box& query) const {
+    std::vector<size_t> result;
+    search(query, result);
+    return result;
+  }
+
+  std::vector<size_t> SpatialIndex::nearest(const arr3f& p, size_t k, float max_distance) const {
+    std::vector<size_t> result;
+    if (n_items_ == 0 || k == 0) return result;
+    float max_d2 = max_distance * max_distance;
+
+    struct Entry {
+      float d2;
+      size_t pos;
+      // 0 for items, pos is then the item id
+      size_t level;
+      bool operator<(const Entry& other) const { return d2 > other.d2; };
+    };
+    std::priority_queue<Entry> queue;
+    size_t pos = indices_.size() - 1, level = level_bounds_.size() - 1;
+    while (true) {
+      size_t first = indices_[pos], last = std::min(first + node_size_, level_bounds_[level-1]);
+      for (size_t c = first; c < last; ++c) {
+        if (!is_valid(&boxes_[4*c])) continue;
+        float d2 = squared_distance(&boxes_[4*c], p[0], p[1]);
+        if (d2 > max_d2) continue;
+        if (level == 1) queue.push({d2, indices_[c], 0});
+        else queue.push({d2, c, level-1});
+      }
+      // items that are closer than any unexplored node are final
+      while (!queue.empty() && queue.top().level == 0) {
+        result.push_back(queue.top().pos);
+        queue.pop();
+        if (result.size() == k) return result;
+      }
+      if (queue.empty()) break;
+      pos = queue.top().pos;
+      level = queue.top().level;
+      queue.pop();
+    }
+    return result;
+  }
+
+  // run query(i, result) for every query on the shared executor and gather the results in offsets and items
+  template <typename Query> static void batch_query(size_t n_queries, vec1ui& offsets, vec1ui& items, Query query) {
+    size_t n_tasks = std::max(size_t(1), std::min(4*get_concurrency(), n_queries / 256));
+    std::vector<vec1ui> task_counts(n_tasks), task_items(n_tasks);
+    parallel_invoke(n_tasks, [&](size_t t) {
+      size_t begin = n_queries * t / n_tasks, end = n_queries * (t+1) / n_tasks;
+      task_counts[t].reserve(end - begin);
+      for (size_t i = begin; i < end; ++i) {
+        size_t before = task_items[t].size();
+        query(i, task_items[t]);
+        task_counts[t].push_back(task_items[t].size() - before);
+      }
+    });
+    offsets.assign(1, 0);
+    offsets.reserve(n_queries + 1);
+    items.clear();
+    for (size_t t = 0; t < n_tasks; ++t) {
+      for (auto count : task_counts[t]) offsets.push_back(offsets.back() + count);
+      items.insert(items.end(), task_items[t].begin(), task_items[t].end());
+    }
+  }
+
+  void SpatialIndex::search(const std::vector<Box>& queries, vec1ui& offsets, vec1ui& items) const {
+    batch_query(queries.size(), offsets, items, [&](size_t i, vec1ui& result) {
+      search(queries[i], result);
+    });
+  }
+  void SpatialIndex::nearest(const vec3f& points, size_t k, vec1ui& offsets, vec1ui& items, float max_distance) const {
+    batch_query(points.size(), offsets, items, [&](size_t i, vec1ui& result) {
+      auto found = nearest(points[i], k, max_distance);
+      result.insert(result.end(), found.begin(), found.end());
+    });
+  }
+}
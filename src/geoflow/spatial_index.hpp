@@ -0,0 +1,84 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include "common.hpp"
+
+namespace geoflow {
+
+  // Position along a Hilbert or Morton (Z-order) curve of a point on a 65536 x 65536 grid
+  uint32_t hilbert_key(uint32_t x, uint32_t y);
+  uint32_t morton_key(uint32_t x, uint32_t y);
+
+  enum SpaceFillingCurve {GF_HILBERT, GF_MORTON};
+  // Order of the points along a space filling curve through their xy extent, ie. order[i] is the index of the i-th
+  // point on the curve. Points with equal keys keep their input order and points with NaN coordinates go last.
+  vec1ui spatial_order(const vec3f& points, SpaceFillingCurve curve=GF_HILBERT);
+
+  // Split the points into spatially compact groups with a total weight of about target_weight by recursive splits
+  // of the longest side of their xy extent (a kd-tree). Groups are returned in tree order, every group holds sorted
+  // point indices. Points with NaN coordinates are put in a separate group at the end.
+  std::vector<vec1ui> kd_partition(const vec3f& points, const vec1ui& weights, size_t target_weight);
+
+  // box of a geometry as it is stored in a terminal, nullopt for empty geometries and types that are not geometries
+  std::optional<Box> geometry_box(const std::any& geometry);
+
+  // Static packed R-tree over the xy extent of item boxes. Items are sorted along a Hilbert curve by the centre of
+  // their box and packed bottom up into nodes of node_size children. All nodes are kept in flat arrays, leaves first
+  // and the root last. Items are identified by their position in the input and at most 2^32-1 items are supported.
+  class SpatialIndex {
+    size_t node_size_ = 16;
+    size_t n_items_ = 0;
+    // 4 floats per node: min x, min y, max x, max y
+    std::vector<float> boxes_;
+    // leaf: item id, otherwise the position of the first child
+    std::vector<uint32_t> indices_;
+    // end position of every level, level 0 are the leaves
+    std::vector<size_t> level_bounds_;
+
+    // item_boxes holds 4 floats per item like boxes_
+    void build(const std::vector<float>& item_boxes);
+
+    public:
+    SpatialIndex() {};
+    // items with an empty box are indexed, but never returned by queries
+    explicit SpatialIndex(const std::vector<Box>& boxes, size_t node_size=16);
+    explicit SpatialIndex(const LinearRingCollection& rings, size_t node_size=16);
+    explicit SpatialIndex(const PointCollection& points, size_t node_size=16);
+    explicit SpatialIndex(const TriangleCollection& triangles, size_t node_size=16);
+
+    size_t size() const { return n_items_; };
+    bool empty() const { return n_items_ == 0; };
+    size_t node_size() const { return node_size_; };
+    Box extent() const;
+
+    // ids of the items with a box that intersects the query box in xy, in no particular order
+    void search(const Box& query, std::vector<size_t>& result) const;
+    std::vector<size_t> search(const Box& query) const;
+    // the k items closest to p in xy, closest first. The distance to an item is the distance to its box.
+    std::vector<size_t> nearest(const arr3f& p, size_t k=1, float max_distance=std::numeric_limits<float>::infinity()) const;
+
+    // Batch versions, the queries are divided over the workers of the shared executor. The results of query i are
+    // items[offsets[i]] to items[offsets[i+1]].
+    void search(const std::vector<Box>& queries, vec1ui& offsets, vec1ui& items) const;
+    void nearest(const vec3f& points, size_t k, vec1ui& offsets, vec1ui& items, float max_distance=std::numeric_limits<float>::infinity()) const;
+  };
+}
@@ -0,0 +1,101 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+#include "spatial_join.hpp"
+#include "spatial_index.hpp"
+#include "parallel.hpp"
+
+namespace geoflow {
+
+  // crossing number test
+  static bool in_ring(const vec3f& ring, float x, float y) {
+    bool inside = false;
+    for (size_t i = 0, j = ring.size()-1; i < ring.size(); j = i++) {
+      const arr3f& a = ring[i];
+      const arr3f& b = ring[j];
+      if ((a[1] > y) != (b[1] > y) && x < (b[0] - a[0]) * (y - a[1]) / (b[1] - a[1]) + a[0]) {
+        inside = !inside;
+      }
+    }
+    return inside;
+  }
+  static bool in_polygon(const LinearRing& polygon, float x, float y) {
+    if (polygon.size() < 3 || !in_ring(polygon, x, y)) return false;
+    for (auto& iring : polygon.interior_rings()) {
+      if (iring.size() >= 3 && in_ring(iring, x, y)) return false;
+    }
+    return true;
+  }
+
+  vec1i points_in_polygons(const PointCollection& points, const std::vector<LinearRing>& polygons) {
+    std::vector<const LinearRing*> polygon_ptrs;
+    polygon_ptrs.reserve(polygons.size());
+    for (auto& polygon : polygons) polygon_ptrs.push_back(&polygon);
+    return points_in_polygons(points, polygon_ptrs);
+  }
+
+  vec1i points_in_polygons(const PointCollection& points, const std::vector<const LinearRing*>& polygons) {
+    vec1i polygon_ids(points.size(), -1);
+    if (points.empty() || polygons.empty()) return polygon_ids;
+
+    // interior rings lie inside the exterior ring, so its box is the box of the polygon
+    std::vector<Box> boxes(polygons.size());
+    parallel_for(polygons.size(), [&](size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        boxes[i].add(*polygons[i]);
+      }
+    }, 1024);
+    SpatialIndex index(boxes);
+
+    parallel_for(points.size(), [&](size_t begin, size_t end) {
+      std::vector<size_t> candidates;
+      for (size_t i = begin; i < end; ++i) {
+        auto& p = points[i];
+        Box query;
+        query.add(p);
+        candidates.clear();
+        index.search(query, candidates);
+        std::sort(candidates.begin(), candidates.end());
+        for (auto c : candidates) {
+          if (in_polygon(*polygons[c], p[0], p[1])) {
+            polygon_ids[i] = int(c);
+            break;
+          }
+        }
+      }
+    }, 4096);
+    return polygon_ids;
+  }
+
+  void group_by_polygon(const vec1i& polygon_ids, size_t n_polygons, std::vector<uint32_t>& offsets, std::vector<uint32_t>& indices) {
+    if (polygon_ids.size() > std::numeric_limits<uint32_t>::max())
+      throw std::length_error("can not group more than 2^32-1 points by polygon");
+    offsets.assign(n_polygons + 1, 0);
+    for (auto id : polygon_ids) {
+      if (id >= 0) ++offsets[id + 1];
+    }
+    for (size_t i = 0; i < n_polygons; ++i) offsets[i+1] += offsets[i];
+    indices.resize(offsets.back());
+    std::vector<uint32_t> next(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < polygon_ids.size(); ++i) {
+      if (polygon_ids[i] >= 0) indices[next[polygon_ids[i]]++] = uint32_t(i);
+    }
+  }
+}
@@ -0,0 +1,37 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "common.hpp"
+
+namespace geoflow {
+
+  // Index of the polygon that contains each point (in xy), -1 for points outside of all polygons. Points in
+  // overlapping polygons get the lowest polygon index, points exactly on a boundary may end up on either side.
+  // The polygons are indexed with a SpatialIndex and the points are processed in parallel.
+  vec1i points_in_polygons(const PointCollection& points, const std::vector<LinearRing>& polygons);
+  // same, for polygons that are stored elsewhere (eg. in the elements of a vector terminal)
+  vec1i points_in_polygons(const PointCollection& points, const std::vector<const LinearRing*>& polygons);
+
+  // Group points by polygon id (as returned by points_in_polygons). The points of polygon i are
+  // indices[offsets[i]] to indices[offsets[i+1]], in increasing order. 32 bit indices like SpatialIndex, which keeps
+  // them at 4 bytes per point, throws std::length_error for more than 2^32-1 points.
+  void group_by_polygon(const vec1i& polygon_ids, size_t n_polygons, std::vector<uint32_t>& offsets, std::vector<uint32_t>& indices);
+}
@@ -0,0 +1,225 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#include <charconv>
+#include <cstdio>
+
+#include "string_template.hpp"
+
+namespace geoflow {
+
+  StringTemplate::StringTemplate(const std::string& text) {
+    parse(text);
+  }
+
+  void StringTemplate::parse(const std::string& text) {
+    segments_.clear();
+    size_t pos = 0;
+    while (pos < text.size()) {
+      // the first complete placeholder of either kind, an unterminated "{{" or "[[" does not hide the other kind
+      size_t open_global = text.find("{{", pos), close_global = std::string::npos;
+      if (open_global != std::string::npos)
+        close_global = text.find("}}", open_global+2);
+      size_t open_attribute = text.find("[[", pos), close_attribute = std::string::npos;
+      if (open_attribute != std::string::npos)
+        close_attribute = text.find("]]", open_attribute+2);
+      if (close_global == std::string::npos) open_global = std::string::npos;
+      if (close_attribute == std::string::npos) open_attribute = std::string::npos;
+      bool is_global = open_global <= open_attribute;
+      size_t open = is_global ? open_global : open_attribute;
+      size_t close = is_global ? close_global : close_attribute;
+      if (open == std::string::npos) {
+        // no more (complete) placeholders
+        segments_.emplace_back(LITERAL, text.substr(pos));
+        break;
+      }
+      if (open > pos)
+        segments_.emplace_back(LITERAL, text.substr(pos, open-pos));
+      segments_.emplace_back(is_global ? GLOBAL : ATTRIBUTE, text.substr(open+2, close-open-2));
+      pos = close+2;
+    }
+  }
+
+  bool StringTemplate::has_globals() const {
+    for (auto& segment : segments_) {
+      if (segment.type == GLOBAL) return true;
+    }
+    return false;
+  }
+  bool StringTemplate::has_attributes() const {
+    for (auto& segment : segments_) {
+      if (segment.type == ATTRIBUTE) return true;
+    }
+    return false;
+  }
+
+  StringTemplate::ValueType StringTemplate::value_type_of(std::type_index type) {
+    if (type == typeid(std::string)) return STRING;
+    if (type == typeid(int)) return INT;
+    if (type == typeid(float)) return FLOAT;
+    if (type == typeid(bool)) return BOOL;
+    return UNBOUND;
+  }
+
+  void StringTemplate::bind_globals(const NodeManager& manager) {
+    manager_ = &manager;
+    for (auto& segment : segments_) {
+      if (segment.type != GLOBAL) continue;
+      // expanded values are bound again on their next render
+      segment.expansion.reset();
+      auto it = manager.global_flowchart_params.find(segment.text);
+      if (it == manager.global_flowchart_params.end())
+        throw gfException("subtitute param is not subtituted: " + segment.text);
+      auto& param = it->second;
+      if (param->is_type(typeid(std::string)))
+        segment.value_type = STRING;
+      else if (param->is_type(typeid(int)))
+        segment.value_type = INT;
+      else if (param->is_type(typeid(float)))
+        segment.value_type = FLOAT;
+      else if (param->is_type(typeid(bool)))
+        segment.value_type = BOOL;
+      else
+        throw gfException("subtitute param is not found");
+      segment.global = param;
+    }
+  }
+
+  bool StringTemplate::globals_are_bound_to(const NodeManager& manager) const {
+    if (manager_ != &manager) return false;
+    for (auto& segment : segments_) {
+      if (segment.type != GLOBAL) continue;
+      auto it = manager.global_flowchart_params.find(segment.text);
+      if (it == manager.global_flowchart_params.end() || it->second != segment.global)
+        return false;
+      if (segment.expansion && !segment.expansion->globals_are_bound_to(manager))
+        return false;
+    }
+    return true;
+  }
+
+  void StringTemplate::bind_attributes(gfMultiFeatureInputTerminal& term) {
+    attribute_term_ = &term;
+    for (auto& segment : segments_) {
+      if (segment.type == GLOBAL) segment.expansion.reset();
+      if (segment.type != ATTRIBUTE) continue;
+      segment.attribute = nullptr;
+      for (auto& sterm : term.sub_terminals()) {
+        if (sterm->get_name() == segment.text) {
+          segment.attribute = sterm;
+          break;
+        }
+      }
+      if (!segment.attribute)
+        throw gfException("subtitute param is not subtituted: " + segment.text);
+      segment.value_type = value_type_of(segment.attribute->get_type());
+      if (segment.value_type == UNBOUND)
+        throw gfException("subtitute param is not found");
+    }
+  }
+
+  void StringTemplate::append_placeholder(const Segment& segment) {
+    if (segment.type == GLOBAL)
+      buffer_ += "{{" + segment.text + "}}";
+    else
+      buffer_ += "[[" + segment.text + "]]";
+  }
+
+  void StringTemplate::append_string_global(Segment& segment, const std::string& value, size_t i, size_t depth) {
+    if (value.find("{{") == std::string::npos && value.find("[[") == std::string::npos) {
+      buffer_ += value;
+      return;
+    }
+    // a global that refers to other globals (or attributes), eg. OUT = "{{BASE}}/out"
+    const size_t max_depth = 32;
+    if (depth >= max_depth)
+      throw gfException("global " + segment.text + " can not be substituted, it refers to itself");
+    if (!segment.expansion || segment.expanded_text != value) {
+      segment.expansion = std::make_shared<StringTemplate>(value);
+      segment.expanded_text = value;
+      if (manager_) segment.expansion->bind_globals(*manager_);
+      if (attribute_term_) segment.expansion->bind_attributes(*attribute_term_);
+    }
+    buffer_ += segment.expansion->render(i, depth+1);
+  }
+
+  const std::string& StringTemplate::render(size_t i) {
+    return render(i, 0);
+  }
+
+  const std::string& StringTemplate::render(size_t i, size_t depth) {
+    buffer_.clear();
+    char number[64];
+    for (auto& segment : segments_) {
+      if (segment.type == LITERAL) {
+        buffer_ += segment.text;
+        continue;
+      }
+      if (segment.value_type == UNBOUND) {
+        append_placeholder(segment);
+        continue;
+      }
+      // fetch the value from the bound global or attribute column
+      const std::string* str_val = nullptr;
+      int int_val = 0;
+      float float_val = 0;
+      bool bool_val = false;
+      if (segment.type == GLOBAL) {
+        auto param = segment.global.get();
+        switch (segment.value_type) {
+          case STRING: str_val = &static_cast<ParameterByValue<std::string>*>(param)->get(); break;
+          case INT: int_val = static_cast<ParameterByValue<int>*>(param)->get(); break;
+          case FLOAT: float_val = static_cast<ParameterByValue<float>*>(param)->get(); break;
+          case BOOL: bool_val = static_cast<ParameterByValue<bool>*>(param)->get(); break;
+          default: break;
+        }
+      } else {
+        auto& value = segment.attribute->get_any(i);
+        switch (segment.value_type) {
+          case STRING: str_val = &std::any_cast<const std::string&>(value); break;
+          case INT: int_val = std::any_cast<int>(value); break;
+          case FLOAT: float_val = std::any_cast<float>(value); break;
+          case BOOL: bool_val = std::any_cast<bool>(value); break;
+          default: break;
+        }
+      }
+      // format it like std::to_string does
+      switch (segment.value_type) {
+        case STRING:
+          if (segment.type == GLOBAL)
+            append_string_global(segment, *str_val, i, depth);
+          else
+            buffer_ += *str_val;
+          break;
+        case INT: {
+          auto result = std::to_chars(number, number+sizeof(number), int_val);
+          buffer_.append(number, result.ptr);
+          break;
+        }
+        case FLOAT: {
+          int n = std::snprintf(number, sizeof(number), "%f", float_val);
+          buffer_.append(number, n);
+          break;
+        }
+        case BOOL:
+          buffer_ += bool_val ? "true" : "false";
+          break;
+        default: break;
+      }
+    }
+    return buffer_;
+  }
+}
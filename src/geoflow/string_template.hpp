@@ -0,0 +1,83 @@
+// This file is part of Geoflow
+// Copyright (C) 2018-2022 Ravi Peters
+
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "geoflow.hpp"
+
+namespace geoflow {
+
+  // Text with {{global}} and [[attribute]] placeholders that is parsed once. Globals are bound to the parameters of a
+  // NodeManager and attributes to the sub terminals of a poly input. After that, render() only copies the literal parts
+  // and formats the bound values into a buffer that is reused between calls, eg. to create one filename per feature:
+  //
+  //   StringTemplate filepath(filepath_);
+  //   filepath.bind_globals(manager);
+  //   filepath.bind_attributes(poly_input("attributes"));
+  //   for (size_t i=0; i<n; ++i) write(filepath.render(i));
+  //
+  // Placeholders that are not bound are rendered as they appear in the text. String globals whose value contains
+  // placeholders themselves are expanded recursively, with the same bindings.
+  class StringTemplate {
+    public:
+    StringTemplate(const std::string& text="");
+
+    void parse(const std::string& text);
+    bool has_globals() const;
+    bool has_attributes() const;
+
+    // bind all global placeholders, throws a gfException if a global does not exist or has an unsupported type
+    void bind_globals(const NodeManager& manager);
+    // true if the globals are bound to the parameters that manager holds now, also for recursively expanded values
+    bool globals_are_bound_to(const NodeManager& manager) const;
+    // bind all attribute placeholders, throws a gfException if an attribute does not exist or has an unsupported type
+    void bind_attributes(gfMultiFeatureInputTerminal& term);
+
+    // text for feature i, the reference is valid until the next call to render
+    const std::string& render(size_t i=0);
+
+    private:
+    enum SegmentType { LITERAL, GLOBAL, ATTRIBUTE };
+    enum ValueType { UNBOUND, STRING, INT, FLOAT, BOOL };
+    struct Segment {
+      Segment(SegmentType type, std::string text)
+        : type(type), text(std::move(text)), value_type(UNBOUND), global(), attribute(nullptr), expansion(), expanded_text() {};
+      SegmentType type;
+      // literal text or placeholder name
+      std::string text;
+      ValueType value_type;
+      std::shared_ptr<Parameter> global;
+      const gfSingleFeatureOutputTerminal* attribute;
+      // template for a string global whose value contains placeholders, parsed from expanded_text
+      std::shared_ptr<StringTemplate> expansion;
+      std::string expanded_text;
+    };
+    std::vector<Segment> segments_;
+    std::string buffer_;
+    // what the placeholders were bound to, also used for values that are expanded recursively
+    const NodeManager* manager_ = nullptr;
+    gfMultiFeatureInputTerminal* attribute_term_ = nullptr;
+
+    static ValueType value_type_of(std::type_index type);
+    void append_placeholder(const Segment& segment);
+    void append_string_global(Segment& segment, const std::string& value, size_t i, size_t depth);
+    const std::string& render(size_t i, size_t depth);
+  };
+}